@@ -42,6 +42,15 @@
 #      qa/workunits/erasure-code/bench.sh fplot jerasure |
 #      tee qa/workunits/erasure-code/bench.js
 #
+# The matrix of plugins, techniques, k/m, sizes and erasures can also
+# be written as one JSON object per run, for instance to compare the
+# SIMD kernels of the jerasure plugin:
+#
+#  SIZES="4096 65536 1048576" JERASURE_SIMD="none ssse3 avx2 avx512 gfni" \
+#  CEPH_ERASURE_CODE_BENCHMARK=src/ceph_erasure_code_benchmark  \
+#  PLUGIN_DIRECTORY=build/lib \
+#      qa/workunits/erasure-code/bench.sh json > bench.json
+#
 set -e
 
 export PATH=/sbin:$PATH
@@ -53,6 +62,8 @@ export PATH=/sbin:$PATH
 : ${TECHNIQUES:=vandermonde cauchy}
 : ${TOTAL_SIZE:=$((1024 * 1024))}
 : ${SIZE:=4096}
+: ${SIZES:=$SIZE}
+: ${JERASURE_SIMD:=auto}
 : ${PARAMETERS:=--parameter jerasure-per-chunk-alignment=true}
 
 function bench_header() {
@@ -149,6 +160,67 @@ function bench_run() {
     done
 }
 
+function bench_matrix() {
+    local w=8
+    local VECTOR_WORDSIZE=16
+    local ks="2 3 4 6 10"
+    declare -A k2ms
+    k2ms[2]="1"
+    k2ms[3]="2"
+    k2ms[4]="2 3"
+    k2ms[6]="2 3 4"
+    k2ms[10]="3 4"
+    local isa2technique_vandermonde='reed_sol_van'
+    local isa2technique_cauchy='cauchy'
+    local jerasure2technique_vandermonde='reed_sol_van'
+    local jerasure2technique_cauchy='cauchy_good'
+    for technique in ${TECHNIQUES} ; do
+        for plugin in ${PLUGINS} ; do
+            eval technique_parameter=\$${plugin}2technique_${technique}
+            local simds=none
+            if [ $plugin = jerasure ] ; then
+                simds="${JERASURE_SIMD}"
+            fi
+            for simd in $simds ; do
+                local simd_parameter=
+                if [ $plugin = jerasure ] ; then
+                    simd_parameter="--parameter jerasure-simd=$simd"
+                fi
+                for size in ${SIZES} ; do
+                    for k in $ks ; do
+                        for m in ${k2ms[$k]} ; do
+                            for erasures in $(seq 0 $m) ; do
+                                local workload=decode
+                                if [ $erasures = 0 ] ; then
+                                    workload=encode
+                                fi
+                                $CEPH_ERASURE_CODE_BENCHMARK \
+                                    --format json \
+                                    --plugin $plugin \
+                                    --workload $workload \
+                                    --iterations $(( ($TOTAL_SIZE + $size - 1) / $size )) \
+                                    --size $size \
+                                    --erasures $erasures \
+                                    --parameter k=$k \
+                                    --parameter m=$m \
+                                    --parameter packetsize=$(packetsize $k $w $VECTOR_WORDSIZE $size) \
+                                    ${PARAMETERS} \
+                                    $simd_parameter \
+                                    --parameter technique=$technique_parameter \
+                                    --erasure-code-dir $PLUGIN_DIRECTORY
+                            done
+                        done
+                    done
+                done
+            done
+        done
+    done
+}
+
+function json() {
+    bench_matrix
+}
+
 function fplot() {
     local serie
     bench_run | while read seconds total plugin k m workload iteration size erasures rest ; do 
@@ -178,7 +250,7 @@ function main() {
     bench_run
 }
 
-if [ "$1" = fplot ] ; then
+if [ "$1" = fplot -o "$1" = json ] ; then
     "$@"
 else
     main
@@ -3,6 +3,7 @@
 
 #include "numa.h"
 
+#include <algorithm>
 #include <cstring>
 #include <errno.h>
 #include <iostream>
@@ -156,7 +157,23 @@ static int easy_readdir(const std::string& dir, std::set<std::string> *out)
   return 0;
 }
 
-#ifdef HAVE_DPDK
+int get_cpu_numa_node(int cpu)
+{
+  // the cpu directory links to the node it is on
+  std::set<std::string> ls;
+  int r = easy_readdir("/sys/devices/system/cpu/cpu"s + stringify(cpu), &ls);
+  if (r < 0) {
+    return r;
+  }
+  for (auto& i : ls) {
+    if (i.compare(0, 4, "node") == 0 && i.size() > 4 &&
+	std::all_of(i.begin() + 4, i.end(), ::isdigit)) {
+      return atoi(i.c_str() + 4);
+    }
+  }
+  return -ENOENT;
+}
+
 static std::string get_task_comm(pid_t tid)
 {
   static const char* comm_fmt = "/proc/self/task/%d/comm";
@@ -182,9 +199,9 @@ static std::string get_task_comm(pid_t tid)
   }
   return name;
 }
-#endif
 
-int set_cpu_affinity_all_threads(size_t cpu_set_size, cpu_set_t *cpu_set)
+int set_cpu_affinity_all_threads(size_t cpu_set_size, cpu_set_t *cpu_set,
+				 const char *skip_prefix)
 {
   // first set my affinity
   int r = sched_setaffinity(getpid(), cpu_set_size, cpu_set);
@@ -215,6 +232,10 @@ int set_cpu_affinity_all_threads(size_t cpu_set_size, cpu_set_t *cpu_set)
         continue;
       }
       #endif
+      if (skip_prefix &&
+	  get_task_comm(tid).compare(0, strlen(skip_prefix), skip_prefix) == 0) {
+	continue;
+      }
       r = sched_setaffinity(tid, cpu_set_size, cpu_set);
       if (r < 0) {
 	return -errno;
@@ -251,8 +272,14 @@ int get_numa_node_cpu_set(int node,
   return -ENOTSUP;
 }
 
+int get_cpu_numa_node(int cpu)
+{
+  return -ENOTSUP;
+}
+
 int set_cpu_affinity_all_threads(size_t cpu_set_size,
-				 cpu_set_t *cpu_set)
+				 cpu_set_t *cpu_set,
+				 const char *skip_prefix)
 {
   return -ENOTSUP;
 }
@@ -20,5 +20,10 @@ int get_numa_node_cpu_set(int node,
 			  size_t *cpu_set_size,
 			  cpu_set_t *cpu_set);
 
+// the numa node of a cpu, or a negative error code
+int get_cpu_numa_node(int cpu);
+
+// threads whose name starts with skip_prefix, if given, are left alone
 int set_cpu_affinity_all_threads(size_t cpu_set_size,
-				 cpu_set_t *cpu_set);
+				 cpu_set_t *cpu_set,
+				 const char *skip_prefix = nullptr);
@@ -283,34 +283,40 @@ seastar::future<> ProtocolV2::read_frame_payload()
 {
   ceph_assert(rx_segments_data.empty());
 
-  return seastar::do_until(
-    [this] { return rx_frame_asm.get_num_segments() == rx_segments_data.size(); },
-    [this] {
-      // TODO: create aligned and contiguous buffer from socket
-      const size_t seg_idx = rx_segments_data.size();
-      if (uint16_t alignment = rx_frame_asm.get_segment_align(seg_idx);
-	  alignment != segment_t::DEFAULT_ALIGNMENT) {
-        logger().trace("{} cannot allocate {} aligned buffer at segment desc index {}",
-                       conn, alignment, rx_segments_data.size());
+  // Read all the segments and the epilogue at once and slice them out
+  // of the result: a frame that is already in the read-ahead buffer of
+  // the socket comes out of it without copying, and a larger one is
+  // assembled into a single buffer instead of one per segment.
+  size_t frame_len = rx_frame_asm.get_epilogue_onwire_len();
+  for (size_t seg_idx = 0; seg_idx < rx_frame_asm.get_num_segments(); ++seg_idx) {
+    if (uint16_t alignment = rx_frame_asm.get_segment_align(seg_idx);
+        alignment != segment_t::DEFAULT_ALIGNMENT) {
+      logger().trace("{} cannot allocate {} aligned buffer at segment desc index {}",
+                     conn, alignment, seg_idx);
+    }
+    frame_len += rx_frame_asm.get_segment_onwire_len(seg_idx);
+  }
+  return read_exactly(frame_len).then([this] (auto frame_bl) {
+    size_t offset = 0;
+    auto slice = [&frame_bl, &offset] (size_t len) {
+      bufferlist bl;
+      if (len > 0) {
+        bl.append(buffer::create(frame_bl.share(offset, len)));
+        offset += len;
       }
-      uint32_t onwire_len = rx_frame_asm.get_segment_onwire_len(seg_idx);
-      // TODO: create aligned and contiguous buffer from socket
-      return read_exactly(onwire_len).then([this] (auto tmp_bl) {
-        logger().trace("{} RECV({}) frame segment[{}]",
-                       conn, tmp_bl.size(), rx_segments_data.size());
-        bufferlist segment;
-        segment.append(buffer::create(std::move(tmp_bl)));
-        rx_segments_data.emplace_back(std::move(segment));
-      });
+      return bl;
+    };
+    while (rx_segments_data.size() < rx_frame_asm.get_num_segments()) {
+      const size_t seg_idx = rx_segments_data.size();
+      rx_segments_data.emplace_back(
+        slice(rx_frame_asm.get_segment_onwire_len(seg_idx)));
+      logger().trace("{} RECV({}) frame segment[{}]",
+                     conn, rx_segments_data.back().length(), seg_idx);
     }
-  ).then([this] {
-    return read_exactly(rx_frame_asm.get_epilogue_onwire_len());
-  }).then([this] (auto bl) {
-    logger().trace("{} RECV({}) frame epilogue", conn, bl.size());
+    auto rx_epilogue = slice(rx_frame_asm.get_epilogue_onwire_len());
+    logger().trace("{} RECV({}) frame epilogue", conn, rx_epilogue.length());
     bool ok = false;
     try {
-      bufferlist rx_epilogue;
-      rx_epilogue.append(buffer::create(std::move(bl)));
       ok = rx_frame_asm.disassemble_segments(rx_preamble, rx_segments_data.data(), rx_epilogue);
     } catch (FrameError& e) {
       logger().error("read_frame_payload: {} {}", conn, e.what());
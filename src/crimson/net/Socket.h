@@ -38,7 +38,7 @@ class Socket
   Socket(seastar::connected_socket&& _socket, side_t _side, uint16_t e_port, construct_tag)
     : sid{seastar::this_shard_id()},
       socket(std::move(_socket)),
-      in(socket.input()),
+      in(socket.input(input_config())),
       // the default buffer size 8192 is too small that may impact our write
       // performance. see seastar::net::connected_socket::output()
       out(socket.output(65536)),
@@ -53,6 +53,15 @@ class Socket
 
   Socket(Socket&& o) = delete;
 
+  // Frames are sliced out of the read-ahead buffers of the input stream
+  // without copying as long as they fit, so start with buffers large
+  // enough for a good number of small messages instead of 8192 bytes.
+  static seastar::connected_socket_input_stream_config input_config() {
+    seastar::connected_socket_input_stream_config config;
+    config.buffer_size = 65536;
+    return config;
+  }
+
   static seastar::future<SocketRef>
   connect(const entity_addr_t& peer_addr) {
     inject_failure();
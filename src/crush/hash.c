@@ -2,6 +2,10 @@
 # include <linux/crush/hash.h>
 #else
 # include "hash.h"
+# include "arch/intel.h"
+# ifdef __x86_64__
+#  include <immintrin.h>
+# endif
 #endif
 
 /*
@@ -140,6 +144,73 @@ __u32 crush_hash32_5(int type, __u32 a, __u32 b, __u32 c, __u32 d, __u32 e)
 	}
 }
 
+#ifndef __KERNEL__
+
+#ifdef __x86_64__
+
+/* crush_hashmix on eight lanes */
+#define crush_hashmix_x8(a, b, c) do {					\
+		a = _mm256_sub_epi32(_mm256_sub_epi32(a, b), c);	\
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 13));	\
+		b = _mm256_sub_epi32(_mm256_sub_epi32(b, c), a);	\
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 8));	\
+		c = _mm256_sub_epi32(_mm256_sub_epi32(c, a), b);	\
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 13));	\
+		a = _mm256_sub_epi32(_mm256_sub_epi32(a, b), c);	\
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 12));	\
+		b = _mm256_sub_epi32(_mm256_sub_epi32(b, c), a);	\
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 16));	\
+		c = _mm256_sub_epi32(_mm256_sub_epi32(c, a), b);	\
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 5));	\
+		a = _mm256_sub_epi32(_mm256_sub_epi32(a, b), c);	\
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 3));	\
+		b = _mm256_sub_epi32(_mm256_sub_epi32(b, c), a);	\
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 10));	\
+		c = _mm256_sub_epi32(_mm256_sub_epi32(c, a), b);	\
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 15));	\
+	} while (0)
+
+/* crush_hash32_rjenkins1_3 of (a, b[i], c) for the first n & ~7 lanes */
+__attribute__((target("avx2")))
+static unsigned int crush_hash32_rjenkins1_3_avx2(__u32 a, const __u32 *b,
+						  __u32 c, __u32 *out,
+						  unsigned int n)
+{
+	unsigned int i;
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i va = _mm256_set1_epi32(a);
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+		__m256i vc = _mm256_set1_epi32(c);
+		__m256i hash = _mm256_xor_si256(
+			_mm256_set1_epi32(crush_hash_seed ^ a ^ c), vb);
+		__m256i x = _mm256_set1_epi32(231232);
+		__m256i y = _mm256_set1_epi32(1232);
+		crush_hashmix_x8(va, vb, hash);
+		crush_hashmix_x8(vc, x, hash);
+		crush_hashmix_x8(y, va, hash);
+		crush_hashmix_x8(vb, x, hash);
+		crush_hashmix_x8(y, vc, hash);
+		_mm256_storeu_si256((__m256i *)(out + i), hash);
+	}
+	return i;
+}
+
+#endif /* __x86_64__ */
+
+void crush_hash32_3_batch(int type, __u32 a, const __u32 *b, __u32 c,
+			  __u32 *out, unsigned int n)
+{
+	unsigned int i = 0;
+#ifdef __x86_64__
+	if (type == CRUSH_HASH_RJENKINS1 && ceph_arch_intel_avx2)
+		i = crush_hash32_rjenkins1_3_avx2(a, b, c, out, n);
+#endif
+	for (; i < n; i++)
+		out[i] = crush_hash32_3(type, a, b[i], c);
+}
+
+#endif /* __KERNEL__ */
+
 const char *crush_hash_name(int type)
 {
 	switch (type) {
@@ -309,10 +309,8 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
-                                                      int weight)
+static inline __s64 exponential_from_hash(unsigned int u, int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -336,6 +334,17 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
+                                                      int weight)
+{
+	return exponential_from_hash(crush_hash32_3(type, x, y, z), weight);
+}
+
+#ifndef __KERNEL__
+/* hashes computed at once by bucket_straw2_choose */
+#define CRUSH_STRAW2_HASH_BATCH 64
+#endif
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
@@ -344,6 +353,33 @@ static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 	__s64 draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
+#ifndef __KERNEL__
+	/*
+	 * the hashes of all the items only differ by the item id, hash
+	 * them in batches so that they can be computed several at a time
+	 */
+	__u32 u[CRUSH_STRAW2_HASH_BATCH];
+	unsigned int j, n;
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_STRAW2_HASH_BATCH)
+			n = CRUSH_STRAW2_HASH_BATCH;
+		crush_hash32_3_batch(bucket->h.hash, x, (const __u32 *)ids + i,
+				     r, u, n);
+		for (j = 0; j < n; j++) {
+			if (weights[i + j]) {
+				draw = exponential_from_hash(u[j], weights[i + j]);
+			} else {
+				draw = S64_MIN;
+			}
+
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
+		}
+	}
+#else
 	for (i = 0; i < bucket->h.size; i++) {
                 dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
 		if (weights[i]) {
@@ -357,6 +393,7 @@ static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 			high_draw = draw;
 		}
 	}
+#endif
 
 	return bucket->h.items[high];
 }
@@ -22,6 +22,7 @@
 
 #include "common/strtol.h"
 #include "include/buffer.h"
+#include "include/ceph_assert.h"
 #include "crush/CrushWrapper.h"
 #include "osd/osd_types.h"
 
@@ -202,6 +203,59 @@ int ErasureCode::encode(const set<int> &want_to_encode,
   return 0;
 }
 
+int ErasureCode::encode_stripes(unsigned stripe_count,
+				const set<int> &want_to_encode,
+				const bufferlist &in,
+				map<int, bufferlist> *encoded)
+{
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  ceph_assert(stripe_count > 0);
+  ceph_assert(in.length() % stripe_count == 0);
+  unsigned stripe_width = in.length() / stripe_count;
+  unsigned blocksize = get_chunk_size(stripe_width);
+  if (stripe_count == 1 ||
+      blocksize * k != stripe_width ||
+      !(get_supported_optimizations() &
+	FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION)) {
+    for (unsigned s = 0; s < stripe_count; s++) {
+      bufferlist stripe;
+      stripe.substr_of(in, s * stripe_width, stripe_width);
+      map<int, bufferlist> chunks;
+      int r = encode(want_to_encode, stripe, &chunks);
+      if (r)
+	return r;
+      for (auto &&[shard, bl] : chunks)
+	(*encoded)[shard].claim_append(bl);
+    }
+    return 0;
+  }
+
+  // gather the chunks of all the stripes so that encode_chunks sees
+  // a single stripe made of stripe_count times larger chunks
+  unsigned length = stripe_count * blocksize;
+  for (unsigned int i = 0; i < k + m; i++) {
+    bufferptr buf(buffer::create_aligned(length, SIMD_ALIGN));
+    if (i < k) {
+      auto p = in.begin(i * blocksize);
+      for (unsigned s = 0; s < stripe_count; s++) {
+	p.copy(blocksize, buf.c_str() + s * blocksize);
+	if (s + 1 < stripe_count)
+	  p += stripe_width - blocksize;
+      }
+    }
+    (*encoded)[chunk_index(i)].push_back(std::move(buf));
+  }
+  int r = encode_chunks(want_to_encode, encoded);
+  if (r)
+    return r;
+  for (unsigned int i = 0; i < k + m; i++) {
+    if (want_to_encode.count(i) == 0)
+      encoded->erase(i);
+  }
+  return 0;
+}
+
 int ErasureCode::_decode(const set<int> &want_to_read,
 			 const map<int, bufferlist> &chunks,
 			 map<int, bufferlist> *decoded)
@@ -247,6 +301,33 @@ int ErasureCode::decode(const set<int> &want_to_read,
   return _decode(want_to_read, chunks, decoded);
 }
 
+int ErasureCode::decode_stripes(unsigned stripe_count,
+				const set<int> &want_to_read,
+				const map<int, bufferlist> &chunks,
+				map<int, bufferlist> *decoded)
+{
+  ceph_assert(stripe_count > 0);
+  ceph_assert(!chunks.empty());
+  unsigned length = chunks.begin()->second.length();
+  ceph_assert(length % stripe_count == 0);
+  if (get_supported_optimizations() & FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION)
+    return _decode(want_to_read, chunks, decoded);
+
+  unsigned blocksize = length / stripe_count;
+  for (unsigned s = 0; s < stripe_count; s++) {
+    map<int, bufferlist> stripe;
+    for (auto &&[shard, bl] : chunks)
+      stripe[shard].substr_of(bl, s * blocksize, blocksize);
+    map<int, bufferlist> out;
+    int r = decode(want_to_read, stripe, &out, blocksize);
+    if (r)
+      return r;
+    for (auto &&[shard, bl] : out)
+      (*decoded)[shard].claim_append(bl);
+  }
+  return 0;
+}
+
 int ErasureCode::parse(const ErasureCodeProfile &profile,
 		       ostream *ss)
 {
@@ -345,4 +426,27 @@ int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
   }
   return r;
 }
+
+void ErasureCode::encode_delta(const bufferptr &old_data,
+			       const bufferptr &new_data,
+			       bufferptr *delta)
+{
+  // every supported code is linear over GF(2^w), where addition is xor
+  ceph_assert(old_data.length() == new_data.length());
+  if (delta->length() != old_data.length()) {
+    *delta = buffer::create_aligned(old_data.length(), SIMD_ALIGN);
+  }
+  const char *o = old_data.c_str();
+  const char *n = new_data.c_str();
+  char *d = delta->c_str();
+  for (unsigned i = 0; i < old_data.length(); ++i) {
+    d[i] = o[i] ^ n[i];
+  }
+}
+
+int ErasureCode::apply_delta(const map<int, bufferptr> &in,
+			     map<int, bufferptr> &out)
+{
+  return -EOPNOTSUPP;
+}
 }
@@ -79,10 +79,20 @@ namespace ceph {
                        const bufferlist &in,
                        std::map<int, bufferlist> *encoded) override;
 
+    int encode_stripes(unsigned stripe_count,
+		       const std::set<int> &want_to_encode,
+		       const bufferlist &in,
+		       std::map<int, bufferlist> *encoded) override;
+
     int decode(const std::set<int> &want_to_read,
                 const std::map<int, bufferlist> &chunks,
                 std::map<int, bufferlist> *decoded, int chunk_size) override;
 
+    int decode_stripes(unsigned stripe_count,
+		       const std::set<int> &want_to_read,
+		       const std::map<int, bufferlist> &chunks,
+		       std::map<int, bufferlist> *decoded) override;
+
     virtual int _decode(const std::set<int> &want_to_read,
 			const std::map<int, bufferlist> &chunks,
 			std::map<int, bufferlist> *decoded);
@@ -113,6 +123,17 @@ namespace ceph {
     int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) override;
 
+    uint64_t get_supported_optimizations() const override {
+      return 0;
+    }
+
+    void encode_delta(const bufferptr &old_data,
+		      const bufferptr &new_data,
+		      bufferptr *delta) override;
+
+    int apply_delta(const std::map<int, bufferptr> &in,
+		    std::map<int, bufferptr> &out) override;
+
   protected:
     int parse(const ErasureCodeProfile &profile,
 	      std::ostream *ss);
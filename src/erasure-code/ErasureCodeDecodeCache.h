@@ -0,0 +1,110 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_DECODE_CACHE_H
+#define CEPH_ERASURE_CODE_DECODE_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "common/ceph_mutex.h"
+
+namespace ceph {
+
+  /**
+   * Bounded LRU of decoding tables, keyed by a signature that
+   * identifies both the code (technique, k, m, w...) and the set of
+   * erased chunks. Building a decoding table usually means inverting
+   * a matrix, which dominates the cost of small degraded reads. The
+   * tables are immutable once built and are handed out as shared
+   * pointers so that they can be used after the lock is released and
+   * outlive their eviction.
+   */
+  template <typename T>
+  class ErasureCodeDecodeCache {
+  public:
+    typedef std::shared_ptr<const T> table_ref;
+
+    // the default is sufficient for all the erasures of a (12,4) code
+    static const size_t default_max_entries = 2516;
+
+    explicit ErasureCodeDecodeCache(size_t _max_entries = default_max_entries)
+      : max_entries(_max_entries) {}
+
+    table_ref get(const std::string &signature) {
+      std::lock_guard l{lock};
+      auto i = tables.find(signature);
+      if (i == tables.end()) {
+	++misses;
+	return table_ref();
+      }
+      ++hits;
+      lru.splice(lru.end(), lru, i->second.first);
+      return i->second.second;
+    }
+
+    /// store table, or return the table another thread stored first
+    table_ref put(const std::string &signature, table_ref table) {
+      std::lock_guard l{lock};
+      auto i = tables.find(signature);
+      if (i != tables.end()) {
+	lru.splice(lru.end(), lru, i->second.first);
+	return i->second.second;
+      }
+      while (!lru.empty() && lru.size() >= max_entries) {
+	tables.erase(lru.front());
+	lru.pop_front();
+      }
+      lru.push_back(signature);
+      tables.emplace(signature, std::make_pair(std::prev(lru.end()), table));
+      return table;
+    }
+
+    void clear() {
+      std::lock_guard l{lock};
+      tables.clear();
+      lru.clear();
+      hits = misses = 0;
+    }
+
+    size_t size() {
+      std::lock_guard l{lock};
+      return lru.size();
+    }
+
+    uint64_t get_hits() {
+      std::lock_guard l{lock};
+      return hits;
+    }
+
+    uint64_t get_misses() {
+      std::lock_guard l{lock};
+      return misses;
+    }
+
+  private:
+    typedef std::list<std::string> lru_list_t;
+    typedef std::pair<lru_list_t::iterator, table_ref> lru_entry_t;
+
+    ceph::mutex lock = ceph::make_mutex("ErasureCodeDecodeCache::lock");
+    const size_t max_entries;
+    lru_list_t lru;
+    std::map<std::string, lru_entry_t> tables;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+}
+
+#endif
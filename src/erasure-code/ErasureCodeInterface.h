@@ -370,6 +370,27 @@ namespace ceph {
     virtual int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Encode **stripe_count** consecutive stripes of **in** at
+     * once. **in** is **stripe_count** times the stripe width long
+     * and each chunk in **encoded** is the concatenation of that
+     * chunk for every stripe, in order. The result is the same as
+     * calling **encode** for each stripe and appending the chunks.
+     *
+     * Plugins that return FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION
+     * encode all the stripes in a single pass.
+     *
+     * @param [in] stripe_count number of stripes in **in**
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] in data to be encoded
+     * @param [out] encoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_stripes(unsigned stripe_count,
+			       const std::set<int> &want_to_encode,
+			       const bufferlist &in,
+			       std::map<int, bufferlist> *encoded) = 0;
+
     /**
      * Decode the **chunks** and store at least **want_to_read**
      * chunks in **decoded**.
@@ -412,6 +433,27 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) = 0;
 
+    /**
+     * Decode **stripe_count** consecutive stripes at once. Each
+     * buffer in **chunks** is the concatenation of that chunk for
+     * every stripe and so is each buffer stored in **decoded**. The
+     * result is the same as calling **decode** for each stripe and
+     * appending the chunks.
+     *
+     * Plugins that return FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION
+     * decode all the stripes in a single pass.
+     *
+     * @param [in] stripe_count number of stripes in each chunk
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks map chunk indexes to chunk data
+     * @param [out] decoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_stripes(unsigned stripe_count,
+			       const std::set<int> &want_to_read,
+			       const std::map<int, bufferlist> &chunks,
+			       std::map<int, bufferlist> *decoded) = 0;
+
     /**
      * Return the ordered list of chunks or an empty vector
      * if no remapping is necessary.
@@ -459,6 +501,61 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Flags returned by **get_supported_optimizations**.
+     */
+    enum {
+      /// **encode_delta** and **apply_delta** are implemented
+      FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION = 1 << 0,
+      /// each byte of a chunk only depends on the bytes at the same
+      /// offset in the other chunks, so the chunks of consecutive
+      /// stripes can be concatenated and coded in a single pass
+      FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION = 1 << 1,
+    };
+
+    /**
+     * Return the optional features implemented by the plugin, as
+     * a mask of FLAG_EC_PLUGIN_* flags.
+     *
+     * @return mask of FLAG_EC_PLUGIN_* flags
+     */
+    virtual uint64_t get_supported_optimizations() const = 0;
+
+    /**
+     * Compute in **delta** the difference between the previous
+     * content of a data chunk, **old_data**, and its new content,
+     * **new_data**. The three buffers must have the same length.
+     *
+     * The result is meant to be passed to **apply_delta** so that
+     * the coding chunks can be updated after a partial overwrite
+     * without reading the data chunks that did not change.
+     *
+     * @param [in] old_data previous content of the data chunk
+     * @param [in] new_data new content of the data chunk
+     * @param [out] delta difference between old_data and new_data
+     */
+    virtual void encode_delta(const bufferptr &old_data,
+			      const bufferptr &new_data,
+			      bufferptr *delta) = 0;
+
+    /**
+     * Update the coding chunks in **out** with the deltas in **in**.
+     *
+     * **in** maps data chunk indexes to the deltas returned by
+     * **encode_delta** for those chunks. **out** maps coding chunk
+     * indexes to the previous content of those chunks, which is
+     * updated in place. All buffers must have the same length.
+     *
+     * Only available if **get_supported_optimizations** returns
+     * FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION.
+     *
+     * @param [in] in map data chunk indexes to deltas
+     * @param [in,out] out map coding chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferptr> &in,
+			    std::map<int, bufferptr> &out) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
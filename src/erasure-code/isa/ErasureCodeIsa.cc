@@ -132,6 +132,46 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+int
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferptr> &in,
+                                   map<int, bufferptr> &out)
+{
+  if (in.empty() || out.empty())
+    return 0;
+  const unsigned blocksize = in.begin()->second.length();
+
+  // ec_encode_data_update() updates all m coding chunks at once, missing
+  // ones are accumulated into scratch buffers
+  unsigned char *coding[m];
+  std::vector<bufferptr> scratch;
+  scratch.reserve(m);
+  for (int i = 0; i < m; i++) {
+    auto p = out.find(k + i);
+    if (p != out.end()) {
+      ceph_assert(p->second.length() == blocksize);
+      coding[i] = (unsigned char*) p->second.c_str();
+    } else {
+      scratch.push_back(buffer::create_aligned(blocksize, SIMD_ALIGN));
+      coding[i] = (unsigned char*) scratch.back().c_str();
+    }
+  }
+
+  for (auto &&[data_index, delta] : in) {
+    ceph_assert(data_index >= 0 && data_index < k);
+    ceph_assert(delta.length() == blocksize);
+    unsigned char *src = (unsigned char*) delta.c_str();
+    if (m == 1)
+      // single parity stripe, see isa_encode()
+      byte_xor(src, coding[0], src + blocksize);
+    else
+      ec_encode_data_update(blocksize, k, m, data_index, encode_tbls,
+                            src, coding);
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -145,6 +145,15 @@ public:
 
   void prepare() override;
 
+  uint64_t get_supported_optimizations() const override
+  {
+    return FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION |
+      (chunk_mapping.empty() ? FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION : 0);
+  }
+
+  int apply_delta(const std::map<int, ceph::bufferptr> &in,
+                  std::map<int, ceph::bufferptr> &out) override;
+
  private:
   int parse(ceph::ErasureCodeProfile &profile,
             std::ostream *ss) override;
@@ -17,7 +17,7 @@
 
 #include "common/debug.h"
 #include "ErasureCodeJerasure.h"
-
+#include "gf8_region.h"
 
 extern "C" {
 #include "jerasure.h"
@@ -39,6 +39,7 @@ using std::map;
 using std::set;
 
 using ceph::bufferlist;
+using ceph::bufferptr;
 using ceph::ErasureCodeProfile;
 
 static ostream& _prefix(std::ostream* _dout)
@@ -74,6 +75,35 @@ int ErasureCodeJerasure::parse(ErasureCodeProfile &profile,
     err = -EINVAL;
   }
   err |= sanity_check_k_m(k, m, ss);
+  // not defaulted into the profile, so that profiles which do not ask
+  // for a kernel stay the same
+  std::string simd = "auto";
+  if (auto i = profile.find("jerasure-simd");
+      i != profile.end() && !i->second.empty()) {
+    simd = i->second;
+  }
+  if (simd == "auto") {
+    region_kernel = gf8_region_kernel_best();
+  } else if (simd == "none") {
+    region_kernel = nullptr;
+  } else if (simd == "ssse3" || simd == "avx2" ||
+	     simd == "avx512" || simd == "gfni") {
+    // the profile is shared by OSDs that may not all have the same CPU
+    region_kernel = gf8_region_kernel_find(simd.c_str());
+    if (!region_kernel) {
+      dout(1) << "jerasure-simd=" << simd << " is not supported by this CPU,"
+	      << " using auto" << dendl;
+      region_kernel = gf8_region_kernel_best();
+    }
+  } else {
+    *ss << "jerasure-simd=" << simd << " must be one of {auto, none, ssse3,"
+	<< " avx2, avx512, gfni}" << std::endl;
+    err = -EINVAL;
+  }
+  if (w != 8)
+    region_kernel = nullptr;
+  dout(10) << "region kernel "
+	   << (region_kernel ? region_kernel->name : "gf-complete") << dendl;
   return err;
 }
 
@@ -137,6 +167,163 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+ceph::ErasureCodeDecodeCache<ErasureCodeJerasure::decode_table_t> &
+ErasureCodeJerasure::decode_cache()
+{
+  static ceph::ErasureCodeDecodeCache<decode_table_t> cache;
+  return cache;
+}
+
+std::string ErasureCodeJerasure::decode_signature(const int *erasures) const
+{
+  std::string signature = technique;
+  signature += " " + std::to_string(k) + " " + std::to_string(m) +
+    " " + std::to_string(w) + " ";
+  std::string erased(k + m, '.');
+  for (int i = 0; erasures[i] != -1; i++)
+    erased[erasures[i]] = 'X';
+  return signature + erased;
+}
+
+static char *chunk_ptr(int k, int id, char **data, char **coding)
+{
+  return id < k ? data[id] : coding[id - k];
+}
+
+int ErasureCodeJerasure::matrix_decode(int *matrix,
+				       int *erasures,
+				       char **data,
+				       char **coding,
+				       int blocksize)
+{
+  std::string signature = decode_signature(erasures);
+  auto table = decode_cache().get(signature);
+  if (!table) {
+    auto t = std::make_shared<decode_table_t>();
+    int erased[k + m];
+    memset(erased, 0, sizeof(erased));
+    int erasures_count = 0;
+    for (; erasures[erasures_count] != -1; erasures_count++)
+      erased[erasures[erasures_count]] = 1;
+    if (erasures_count > m)
+      return -1;
+    // inverse[i * k + j] is the coefficient of src_ids[j] in data chunk i
+    int inverse[k * k];
+    t->src_ids.resize(k);
+    if (jerasure_make_decoding_matrix(k, m, w, matrix, erased,
+				      inverse, t->src_ids.data()) < 0)
+      return -1;
+    for (int id = 0; id < k + m; id++) {
+      if (!erased[id])
+	continue;
+      t->dest_ids.push_back(id);
+      if (id < k) {
+	t->rows.insert(t->rows.end(), inverse + id * k, inverse + (id + 1) * k);
+	continue;
+      }
+      // a coding chunk is its encoding row applied to the decoded data
+      for (int j = 0; j < k; j++) {
+	int c = 0;
+	for (int l = 0; l < k; l++)
+	  c ^= galois_single_multiply(matrix[(id - k) * k + l],
+				      inverse[l * k + j], w);
+	t->rows.push_back(c);
+      }
+    }
+    table = decode_cache().put(signature, std::move(t));
+  }
+
+  int n = table->dest_ids.size();
+  if (region_kernel) {
+    char *src[k];
+    char *dest[n];
+    for (int j = 0; j < k; j++)
+      src[j] = chunk_ptr(k, table->src_ids[j], data, coding);
+    for (int i = 0; i < n; i++)
+      dest[i] = chunk_ptr(k, table->dest_ids[i], data, coding);
+    gf8_region_matrix_encode(region_kernel, k, n, table->rows.data(),
+			     src, dest, blocksize);
+    return 0;
+  }
+  for (int i = 0; i < n; i++)
+    jerasure_matrix_dotprod(k, w, const_cast<int*>(&table->rows[i * k]),
+			    const_cast<int*>(table->src_ids.data()),
+			    table->dest_ids[i], data, coding, blocksize);
+  return 0;
+}
+
+int ErasureCodeJerasure::bitmatrix_decode(int *bitmatrix,
+					  int packetsize,
+					  int *erasures,
+					  char **data,
+					  char **coding,
+					  int blocksize)
+{
+  std::string signature = decode_signature(erasures);
+  auto table = decode_cache().get(signature);
+  if (!table) {
+    auto t = std::make_shared<decode_table_t>();
+    int erased[k + m];
+    memset(erased, 0, sizeof(erased));
+    int erasures_count = 0;
+    for (; erasures[erasures_count] != -1; erasures_count++)
+      erased[erasures[erasures_count]] = 1;
+    if (erasures_count > m)
+      return -1;
+    int kw = k * w;
+    std::vector<int> inverse(kw * kw);
+    t->src_ids.resize(k);
+    if (jerasure_make_decoding_bitmatrix(k, m, w, bitmatrix, erased,
+					 inverse.data(), t->src_ids.data()) < 0)
+      return -1;
+    // one w x kw block of bits per erased chunk, as if the erased
+    // chunks were the coding chunks of the surviving ones
+    std::vector<int> rows;
+    for (int id = 0; id < k + m; id++) {
+      if (!erased[id])
+	continue;
+      t->dest_ids.push_back(id);
+      if (id < k) {
+	rows.insert(rows.end(), inverse.begin() + id * w * kw,
+		    inverse.begin() + (id + 1) * w * kw);
+	continue;
+      }
+      for (int r = 0; r < w; r++) {
+	const int *coding_row = bitmatrix + ((id - k) * w + r) * kw;
+	std::vector<int> row(kw, 0);
+	for (int l = 0; l < kw; l++) {
+	  if (!coding_row[l])
+	    continue;
+	  for (int j = 0; j < kw; j++)
+	    row[j] ^= inverse[l * kw + j];
+	}
+	rows.insert(rows.end(), row.begin(), row.end());
+      }
+    }
+    int **schedule = jerasure_smart_bitmatrix_to_schedule(
+      k, t->dest_ids.size(), w, rows.data());
+    for (int i = 0; schedule[i][0] != -1; i++)
+      t->schedule.insert(t->schedule.end(), schedule[i], schedule[i] + 5);
+    t->schedule.push_back(-1);
+    jerasure_free_schedule(schedule);
+    table = decode_cache().put(signature, std::move(t));
+  }
+
+  int n = table->dest_ids.size();
+  char *src[k];
+  char *dest[n];
+  for (int j = 0; j < k; j++)
+    src[j] = chunk_ptr(k, table->src_ids[j], data, coding);
+  for (int i = 0; i < n; i++)
+    dest[i] = chunk_ptr(k, table->dest_ids[i], data, coding);
+  std::vector<int*> schedule;
+  for (size_t i = 0; i < table->schedule.size(); i += 5)
+    schedule.push_back(const_cast<int*>(&table->schedule[i]));
+  jerasure_schedule_encode(k, n, w, schedule.data(), src, dest,
+			   blocksize, packetsize);
+  return 0;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
@@ -152,6 +339,64 @@ bool ErasureCodeJerasure::is_prime(int value)
   return false;
 }
 
+void ErasureCodeJerasure::matrix_encode(const int *matrix,
+					char **data,
+					char **coding,
+					int blocksize)
+{
+  if (region_kernel)
+    gf8_region_matrix_encode(region_kernel, k, m, matrix,
+			     data, coding, blocksize);
+  else
+    jerasure_matrix_encode(k, m, w, const_cast<int*>(matrix),
+			   data, coding, blocksize);
+}
+
+int ErasureCodeJerasure::matrix_apply_delta(const int *matrix,
+					    const map<int, bufferptr> &in,
+					    map<int, bufferptr> &out)
+{
+  // coding chunk i is the sum over the data chunks j of
+  // matrix[i * k + j] * data[j], so a change to data[j] adds
+  // matrix[i * k + j] * delta to every coding chunk
+  for (auto &&[data_index, delta] : in) {
+    ceph_assert(data_index >= 0 && data_index < k);
+    char *src = const_cast<char*>(delta.c_str());
+    for (auto &&[coding_index, coding] : out) {
+      ceph_assert(coding_index >= k && coding_index < k + m);
+      ceph_assert(coding.length() == delta.length());
+      int coefficient = matrix[(coding_index - k) * k + data_index];
+      if (region_kernel) {
+	region_kernel->multiply((const uint8_t *)src,
+				(uint8_t *)coding.c_str(),
+				delta.length(), coefficient, true);
+	continue;
+      }
+      if (coefficient == 1) {
+	galois_region_xor(src, coding.c_str(), delta.length());
+	continue;
+      }
+      switch (w) {
+      case 8:
+	galois_w08_region_multiply(src, coefficient, delta.length(),
+				   coding.c_str(), 1);
+	break;
+      case 16:
+	galois_w16_region_multiply(src, coefficient, delta.length(),
+				   coding.c_str(), 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(src, coefficient, delta.length(),
+				   coding.c_str(), 1);
+	break;
+      default:
+	return -EINVAL;
+      }
+    }
+  }
+  return 0;
+}
+
 // 
 // ErasureCodeJerasureReedSolomonVandermonde
 //
@@ -159,7 +404,7 @@ void ErasureCodeJerasureReedSolomonVandermonde::jerasure_encode(char **data,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  jerasure_matrix_encode(k, m, w, matrix, data, coding, blocksize);
+  matrix_encode(matrix, data, coding, blocksize);
 }
 
 int ErasureCodeJerasureReedSolomonVandermonde::jerasure_decode(int *erasures,
@@ -167,8 +412,7 @@ int ErasureCodeJerasureReedSolomonVandermonde::jerasure_decode(int *erasures,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  return jerasure_matrix_decode(k, m, w, matrix, 1,
-				erasures, data, coding, blocksize);
+  return matrix_decode(matrix, erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureReedSolomonVandermonde::get_alignment() const
@@ -210,7 +454,10 @@ void ErasureCodeJerasureReedSolomonRAID6::jerasure_encode(char **data,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  reed_sol_r6_encode(k, w, data, coding, blocksize);
+  if (region_kernel)
+    matrix_encode(matrix, data, coding, blocksize);
+  else
+    reed_sol_r6_encode(k, w, data, coding, blocksize);
 }
 
 int ErasureCodeJerasureReedSolomonRAID6::jerasure_decode(int *erasures,
@@ -218,7 +465,7 @@ int ErasureCodeJerasureReedSolomonRAID6::jerasure_decode(int *erasures,
 							 char **coding,
 							 int blocksize)
 {
-  return jerasure_matrix_decode(k, m, w, matrix, 1, erasures, data, coding, blocksize);
+  return matrix_decode(matrix, erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureReedSolomonRAID6::get_alignment() const
@@ -271,8 +518,8 @@ int ErasureCodeJerasureCauchy::jerasure_decode(int *erasures,
 					       char **coding,
 					       int blocksize)
 {
-  return jerasure_schedule_decode_lazy(k, m, w, bitmatrix,
-				       erasures, data, coding, blocksize, packetsize, 1);
+  return bitmatrix_decode(bitmatrix, packetsize,
+			  erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureCauchy::get_alignment() const
@@ -359,8 +606,8 @@ int ErasureCodeJerasureLiberation::jerasure_decode(int *erasures,
                                                     char **coding,
                                                     int blocksize)
 {
-  return jerasure_schedule_decode_lazy(k, m, w, bitmatrix, erasures, data,
-				       coding, blocksize, packetsize, 1);
+  return bitmatrix_decode(bitmatrix, packetsize,
+			  erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureLiberation::get_alignment() const
@@ -19,6 +19,9 @@
 #define CEPH_ERASURE_CODE_JERASURE_H
 
 #include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodeDecodeCache.h"
+
+struct gf8_region_kernel;
 
 class ErasureCodeJerasure : public ceph::ErasureCode {
 public:
@@ -32,6 +35,7 @@ public:
   std::string rule_root;
   std::string rule_failure_domain;
   bool per_chunk_alignment;
+  const gf8_region_kernel *region_kernel;
 
   explicit ErasureCodeJerasure(const char *_technique) :
     k(0),
@@ -41,7 +45,8 @@ public:
     w(0),
     DEFAULT_W("8"),
     technique(_technique),
-    per_chunk_alignment(false)
+    per_chunk_alignment(false),
+    region_kernel(nullptr)
   {}
 
   ~ErasureCodeJerasure() override {}
@@ -65,6 +70,12 @@ public:
 
   int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override;
 
+  uint64_t get_supported_optimizations() const override {
+    // all techniques code each word, or each packet for the bitmatrix
+    // ones, independently of the others
+    return FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION;
+  }
+
   virtual void jerasure_encode(char **data,
                                char **coding,
                                int blocksize) = 0;
@@ -75,8 +86,33 @@ public:
   virtual unsigned get_alignment() const = 0;
   virtual void prepare() = 0;
   static bool is_prime(int value);
+
+  // how to rebuild the erased chunks of one erasure signature from
+  // k of the remaining chunks
+  struct decode_table_t {
+    std::vector<int> src_ids;
+    std::vector<int> dest_ids;
+    // matrix codes: dest_ids.size() rows of k coefficients
+    std::vector<int> rows;
+    // bitmatrix codes: scheduled operations, five ints each, ending
+    // with -1
+    std::vector<int> schedule;
+  };
+  // shared by all the instances of the plugin, the signature
+  // includes the technique, k, m and w
+  static ceph::ErasureCodeDecodeCache<decode_table_t> &decode_cache();
 protected:
   virtual int parse(ceph::ErasureCodeProfile &profile, std::ostream *ss);
+  std::string decode_signature(const int *erasures) const;
+  int matrix_decode(int *matrix, int *erasures,
+		    char **data, char **coding, int blocksize);
+  int bitmatrix_decode(int *bitmatrix, int packetsize, int *erasures,
+		       char **data, char **coding, int blocksize);
+  void matrix_encode(const int *matrix, char **data, char **coding,
+		     int blocksize);
+  int matrix_apply_delta(const int *matrix,
+			 const std::map<int, ceph::bufferptr> &in,
+			 std::map<int, ceph::bufferptr> &out);
 };
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
 public:
@@ -104,6 +140,14 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  uint64_t get_supported_optimizations() const override {
+    return ErasureCodeJerasure::get_supported_optimizations() |
+      (chunk_mapping.empty() ? FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION : 0);
+  }
+  int apply_delta(const std::map<int, ceph::bufferptr> &in,
+		  std::map<int, ceph::bufferptr> &out) override {
+    return matrix_apply_delta(matrix, in, out);
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -134,6 +178,14 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  uint64_t get_supported_optimizations() const override {
+    return ErasureCodeJerasure::get_supported_optimizations() |
+      (chunk_mapping.empty() ? FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION : 0);
+  }
+  int apply_delta(const std::map<int, ceph::bufferptr> &in,
+		  std::map<int, ceph::bufferptr> &out) override {
+    return matrix_apply_delta(matrix, in, out);
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -0,0 +1,311 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "gf8_region.h"
+#include "arch/intel.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+// x^8 + x^4 + x^3 + x^2 + 1, the gf-complete default for w=8
+#define GF8_POLY 0x1d
+
+// keep the destination and the sources of one block of a matrix
+// encode in the L2 cache
+#define GF8_ENCODE_BLOCK (16 * 1024)
+
+uint8_t gf8_mul(uint8_t a, uint8_t b)
+{
+  uint8_t p = 0;
+  while (b) {
+    if (b & 1)
+      p ^= a;
+    b >>= 1;
+    a = (a << 1) ^ ((a & 0x80) ? GF8_POLY : 0);
+  }
+  return p;
+}
+
+// c * x == lo[x & 0xf] ^ hi[x >> 4]
+static void split_tables(uint8_t c, uint8_t *lo, uint8_t *hi)
+{
+  for (int i = 0; i < 16; i++) {
+    lo[i] = gf8_mul(c, i);
+    hi[i] = gf8_mul(c, i << 4);
+  }
+}
+
+static void multiply_tail(const uint8_t *src, uint8_t *dst, size_t len,
+			  const uint8_t *lo, const uint8_t *hi, bool add)
+{
+  for (size_t i = 0; i < len; i++) {
+    uint8_t p = lo[src[i] & 0xf] ^ hi[src[i] >> 4];
+    dst[i] = add ? dst[i] ^ p : p;
+  }
+}
+
+static void xor_tail(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+    dst[i] ^= src[i];
+}
+
+#ifdef __x86_64__
+
+__attribute__((target("ssse3")))
+static void multiply_ssse3(const uint8_t *src, uint8_t *dst, size_t len,
+			   uint8_t c, bool add)
+{
+  uint8_t lo[16], hi[16];
+  split_tables(c, lo, hi);
+  const __m128i tlo = _mm_loadu_si128((const __m128i *)lo);
+  const __m128i thi = _mm_loadu_si128((const __m128i *)hi);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i p = _mm_xor_si128(
+      _mm_shuffle_epi8(tlo, _mm_and_si128(x, mask)),
+      _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+    if (add)
+      p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i *)(dst + i)));
+    _mm_storeu_si128((__m128i *)(dst + i), p);
+  }
+  multiply_tail(src + i, dst + i, len - i, lo, hi, add);
+}
+
+__attribute__((target("sse2")))
+static void xor_sse2(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(x, d));
+  }
+  xor_tail(src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void multiply_avx2(const uint8_t *src, uint8_t *dst, size_t len,
+			  uint8_t c, bool add)
+{
+  uint8_t lo[16], hi[16];
+  split_tables(c, lo, hi);
+  // vpshufb looks up within each 128 bit lane
+  const __m256i tlo = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i *)lo));
+  const __m256i thi = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i *)hi));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i p = _mm256_xor_si256(
+      _mm256_shuffle_epi8(tlo, _mm256_and_si256(x, mask)),
+      _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+    if (add)
+      p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i *)(dst + i)));
+    _mm256_storeu_si256((__m256i *)(dst + i), p);
+  }
+  multiply_tail(src + i, dst + i, len - i, lo, hi, add);
+}
+
+__attribute__((target("avx2")))
+static void xor_avx2(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(x, d));
+  }
+  xor_tail(src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void multiply_avx512(const uint8_t *src, uint8_t *dst, size_t len,
+			    uint8_t c, bool add)
+{
+  uint8_t lo[16], hi[16];
+  split_tables(c, lo, hi);
+  // the zero-masked forms: gcc's unmasked broadcast and 64-bit shift
+  // pass an undefined source that trips -Wuninitialized
+  const __m512i tlo = _mm512_maskz_broadcast_i32x4(
+    0xffff, _mm_loadu_si128((const __m128i *)lo));
+  const __m512i thi = _mm512_maskz_broadcast_i32x4(
+    0xffff, _mm_loadu_si128((const __m128i *)hi));
+  const __m512i mask = _mm512_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m512i x = _mm512_loadu_si512((const void *)(src + i));
+    __m512i p = _mm512_xor_si512(
+      _mm512_shuffle_epi8(tlo, _mm512_and_si512(x, mask)),
+      _mm512_shuffle_epi8(thi, _mm512_and_si512(_mm512_srli_epi16(x, 4), mask)));
+    if (add)
+      p = _mm512_xor_si512(p, _mm512_loadu_si512((const void *)(dst + i)));
+    _mm512_storeu_si512((void *)(dst + i), p);
+  }
+  multiply_tail(src + i, dst + i, len - i, lo, hi, add);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void xor_avx512(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m512i x = _mm512_loadu_si512((const void *)(src + i));
+    __m512i d = _mm512_loadu_si512((const void *)(dst + i));
+    _mm512_storeu_si512((void *)(dst + i), _mm512_xor_si512(x, d));
+  }
+  xor_tail(src + i, dst + i, len - i);
+}
+
+// Multiplying by c is linear over GF(2): bit i of c * x is the parity
+// of x masked by row i, where bit j of row i is bit i of c * 2^j.
+// gf2p8affine takes row i from byte 7 - i of the matrix, which lets
+// it multiply in any field, not only the AES one gf2p8mul is tied to.
+static uint64_t affine_matrix(uint8_t c)
+{
+  uint64_t matrix = 0;
+  for (int i = 0; i < 8; i++) {
+    uint64_t row = 0;
+    for (int j = 0; j < 8; j++)
+      row |= (uint64_t)((gf8_mul(c, 1 << j) >> i) & 1) << j;
+    matrix |= row << (8 * (7 - i));
+  }
+  return matrix;
+}
+
+__attribute__((target("gfni,avx512f,avx512bw")))
+static void multiply_gfni(const uint8_t *src, uint8_t *dst, size_t len,
+			  uint8_t c, bool add)
+{
+  const __m512i a = _mm512_set1_epi64(affine_matrix(c));
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m512i x = _mm512_loadu_si512((const void *)(src + i));
+    __m512i p = _mm512_gf2p8affine_epi64_epi8(x, a, 0);
+    if (add)
+      p = _mm512_xor_si512(p, _mm512_loadu_si512((const void *)(dst + i)));
+    _mm512_storeu_si512((void *)(dst + i), p);
+  }
+  if (i < len) {
+    uint8_t lo[16], hi[16];
+    split_tables(c, lo, hi);
+    multiply_tail(src + i, dst + i, len - i, lo, hi, add);
+  }
+}
+
+__attribute__((target("gfni,avx2")))
+static void multiply_gfni_avx2(const uint8_t *src, uint8_t *dst, size_t len,
+			       uint8_t c, bool add)
+{
+  const __m256i a = _mm256_set1_epi64x(affine_matrix(c));
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i p = _mm256_gf2p8affine_epi64_epi8(x, a, 0);
+    if (add)
+      p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i *)(dst + i)));
+    _mm256_storeu_si256((__m256i *)(dst + i), p);
+  }
+  if (i < len) {
+    uint8_t lo[16], hi[16];
+    split_tables(c, lo, hi);
+    multiply_tail(src + i, dst + i, len - i, lo, hi, add);
+  }
+}
+
+static const gf8_region_kernel kernel_ssse3 = {
+  "ssse3", multiply_ssse3, xor_sse2
+};
+static const gf8_region_kernel kernel_avx2 = {
+  "avx2", multiply_avx2, xor_avx2
+};
+static const gf8_region_kernel kernel_avx512 = {
+  "avx512", multiply_avx512, xor_avx512
+};
+static const gf8_region_kernel kernel_gfni = {
+  "gfni", multiply_gfni, xor_avx512
+};
+static const gf8_region_kernel kernel_gfni_avx2 = {
+  "gfni", multiply_gfni_avx2, xor_avx2
+};
+
+const gf8_region_kernel *gf8_region_kernel_find(const char *name)
+{
+  if (strcmp(name, "gfni") == 0 && ceph_arch_intel_gfni) {
+    if (ceph_arch_intel_avx512bw)
+      return &kernel_gfni;
+    if (ceph_arch_intel_avx2)
+      return &kernel_gfni_avx2;
+  }
+  if (strcmp(name, "avx512") == 0 && ceph_arch_intel_avx512bw)
+    return &kernel_avx512;
+  if (strcmp(name, "avx2") == 0 && ceph_arch_intel_avx2)
+    return &kernel_avx2;
+  if (strcmp(name, "ssse3") == 0 && ceph_arch_intel_ssse3)
+    return &kernel_ssse3;
+  return nullptr;
+}
+
+#else // __x86_64__
+
+const gf8_region_kernel *gf8_region_kernel_find(const char *name)
+{
+  return nullptr;
+}
+
+#endif // __x86_64__
+
+const gf8_region_kernel *gf8_region_kernel_best()
+{
+  for (const char *name : { "gfni", "avx512", "avx2", "ssse3" }) {
+    const gf8_region_kernel *kernel = gf8_region_kernel_find(name);
+    if (kernel)
+      return kernel;
+  }
+  return nullptr;
+}
+
+void gf8_region_matrix_encode(const gf8_region_kernel *kernel,
+			      int k, int m, const int *matrix,
+			      char **data, char **coding, size_t len)
+{
+  for (size_t offset = 0; offset < len; offset += GF8_ENCODE_BLOCK) {
+    size_t block = std::min<size_t>(GF8_ENCODE_BLOCK, len - offset);
+    for (int i = 0; i < m; i++) {
+      uint8_t *dst = (uint8_t *)coding[i] + offset;
+      bool add = false;
+      for (int j = 0; j < k; j++) {
+	uint8_t c = matrix[i * k + j];
+	const uint8_t *src = (const uint8_t *)data[j] + offset;
+	if (c == 0)
+	  continue;
+	if (c == 1 && add)
+	  kernel->xor_region(src, dst, block);
+	else if (c == 1)
+	  memcpy(dst, src, block);
+	else
+	  kernel->multiply(src, dst, block, c, add);
+	add = true;
+      }
+      if (!add)
+	memset(dst, 0, block);
+    }
+  }
+}
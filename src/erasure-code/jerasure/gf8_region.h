@@ -0,0 +1,50 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_JERASURE_GF8_REGION_H
+#define CEPH_JERASURE_GF8_REGION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * GF(2^8) region operations selected at run time from the features
+ * of the CPU rather than from the flags gf-complete was built with.
+ * They use the same field as galois_w08_region_multiply (polynomial
+ * 0x11d) and can be mixed freely with it.
+ */
+struct gf8_region_kernel {
+  const char *name;
+  // dst = c * src, or dst ^= c * src if add is true
+  void (*multiply)(const uint8_t *src, uint8_t *dst, size_t len,
+		   uint8_t c, bool add);
+  // dst ^= src
+  void (*xor_region)(const uint8_t *src, uint8_t *dst, size_t len);
+};
+
+// the fastest kernel this CPU supports, or nullptr if there is none
+// better than the gf-complete build time selection
+const gf8_region_kernel *gf8_region_kernel_best();
+
+// the kernel called name ("ssse3", "avx2", "avx512", "gfni"), or
+// nullptr if it is unknown or not supported by this CPU
+const gf8_region_kernel *gf8_region_kernel_find(const char *name);
+
+// coding[i] = sum over j of matrix[i * k + j] * data[j]
+void gf8_region_matrix_encode(const gf8_region_kernel *kernel,
+			      int k, int m, const int *matrix,
+			      char **data, char **coding, size_t len);
+
+// multiply by a scalar, for building the tables of the kernels
+uint8_t gf8_mul(uint8_t a, uint8_t b);
+
+#endif
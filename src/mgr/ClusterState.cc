@@ -89,9 +89,7 @@ void ClusterState::ingest_pgstats(ref_t<MPGStats> stats)
     pending_inc.update_stat(from, std::move(empty_stat));  
   }
 
-  for (auto p : stats->pg_stat) {
-    pg_t pgid = p.first;
-    const auto &pg_stats = p.second;
+  for (auto& [pgid, pg_stats] : stats->pg_stat) {
 
     // In case we're hearing about a PG that according to last
     // OSDMap update should not exist
@@ -124,8 +122,15 @@ void ClusterState::ingest_pgstats(ref_t<MPGStats> stats)
 	       << q->second.reported_seq << dendl;
       continue;
     }
+    // every report carries all of the osd's primary pgs, most of them
+    // unchanged since the last one
+    if (q != pg_map.pg_stat.end() &&
+	q->second.get_version_pair() == pg_stats.get_version_pair() &&
+	q->second == pg_stats) {
+      continue;
+    }
 
-    pending_inc.pg_stat_updates[pgid] = pg_stats;
+    pending_inc.pg_stat_updates[pgid] = std::move(pg_stats);
   }
   for (auto p : stats->pool_stat) {
     pending_inc.pool_statfs_updates[std::make_pair(p.first, from)] = p.second;
@@ -773,6 +773,9 @@ int Monitor::preinit()
   }
 
   paxos->init_logger();
+  for (auto& svc : paxos_service) {
+    svc->init_logger();
+  }
 
   // verify cluster_uuid
   {
@@ -826,6 +826,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << "update_from_paxos  applying incremental " << osdmap.epoch+1
 	    << dendl;
     OSDMap::Incremental inc(inc_bl);
+    mapping.note_incremental(osdmap, inc);
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
 
@@ -870,6 +871,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	mapping.clear_incrementals();
 
 	dout(20) << __func__ << " canonical full osdmap:\n";
 	JSONFormatter jf(true);
@@ -1073,6 +1075,7 @@ void OSDMonitor::start_mapping()
   } else {
     dout(10) << __func__ << " no pools, no mapping job" << dendl;
     mapping_job = nullptr;
+    mapping.clear_incrementals();
   }
 }
 
@@ -2255,24 +2258,28 @@ void OSDMonitor::share_map_with_random_osd()
     return;
   }
 
-  MonSession *s = mon.session_map.get_random_osd_session(&osdmap);
-  if (!s) {
+  // the osds pass the map on to their peers; seeding several of them
+  // gets it across a large cluster in fewer hops
+  auto fanout = g_conf().get_val<uint64_t>("mon_osd_map_share_fanout");
+  auto sessions = mon.session_map.get_random_osd_sessions(osdmap, fanout);
+  if (sessions.empty()) {
     dout(10) << __func__ << " no up osd on our session map" << dendl;
     return;
   }
+  for (MonSession *s : sessions) {
+    dout(10) << "committed, telling random " << s->name
+	     << " all about it" << dendl;
 
-  dout(10) << "committed, telling random " << s->name
-	   << " all about it" << dendl;
-
-  // get feature of the peer
-  // use quorum_con_features, if it's an anonymous connection.
-  uint64_t features = s->con_features ? s->con_features :
-                                        mon.get_quorum_con_features();
-  // whatev, they'll request more if they need it
-  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(), features);
-  s->con->send_message(m);
-  // NOTE: do *not* record osd has up to this epoch (as we do
-  // elsewhere) as they may still need to request older values.
+    // get feature of the peer
+    // use quorum_con_features, if it's an anonymous connection.
+    uint64_t features = s->con_features ? s->con_features :
+                                          mon.get_quorum_con_features();
+    // whatev, they'll request more if they need it
+    MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(), features);
+    s->con->send_message(m);
+    // NOTE: do *not* record osd has up to this epoch (as we do
+    // elsewhere) as they may still need to request older values.
+  }
 }
 
 version_t OSDMonitor::get_trim_to() const
@@ -14387,7 +14394,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap mappings for this pool
-  for (auto& p : osdmap.pg_upmap) {
+  for (auto& p : *osdmap.pg_upmap) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap "
@@ -14410,7 +14417,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap_items mappings for this pool
-  for (auto& p : osdmap.pg_upmap_items) {
+  for (auto& p : *osdmap.pg_upmap_items) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_items " << p.first
@@ -1134,14 +1134,22 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
 
     auto pg_stat_iter = pg_stat.find(update_pg);
     pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
+    bool sameosds = false;
     if (pg_stat_iter == pg_stat.end()) {
       pg_stat.insert(make_pair(update_pg, update_stat));
     } else {
-      stat_pg_sub(update_pg, pg_stat_iter->second);
+      // most updates leave the pg where it was; those do not need to
+      // touch the per-osd indexes
+      const pg_stat_t &cur_stat(pg_stat_iter->second);
+      sameosds = (cur_stat.up == update_stat.up &&
+		  cur_stat.acting == update_stat.acting &&
+		  cur_stat.up_primary == update_stat.up_primary &&
+		  cur_stat.blocked_by == update_stat.blocked_by);
+      stat_pg_sub(update_pg, pg_stat_iter->second, sameosds);
       pool_sum_ref.sub(pg_stat_iter->second);
       pg_stat_iter->second = update_stat;
     }
-    stat_pg_add(update_pg, update_stat);
+    stat_pg_add(update_pg, update_stat, sameosds);
     pool_sum_ref.add(update_stat);
   }
 
@@ -630,6 +630,7 @@ void Paxos::begin(bufferlist& v)
   accepted.clear();
   accepted.insert(mon.rank);
   new_value = v;
+  begin_stamp = ceph_clock_now();
 
   if (last_committed == 0) {
     auto t(std::make_shared<MonitorDBStore::Transaction>());
@@ -902,6 +903,14 @@ void Paxos::commit_finish()
 
   last_committed++;
   last_commit_time = ceph_clock_now();
+  if (!begin_stamp.is_zero()) {
+    avg_round_latency = update_round_latency(
+      avg_round_latency,
+      last_commit_time - begin_stamp,
+      g_conf()->paxos_min_wait,
+      g_conf()->paxos_propose_interval);
+    begin_stamp = utime_t();
+  }
 
   // refresh first_committed; this txn may have trimmed.
   first_committed = get_store()->get(get_name(), "first_committed");
@@ -115,6 +115,7 @@ e 12v
 #include "msg/msg_types.h"
 #include "include/Context.h"
 #include "common/perf_counters.h"
+#include <algorithm>
 #include <errno.h>
 
 #include "MonitorDBStore.h"
@@ -355,6 +356,13 @@ private:
    * When the commit finished.
    */
   utime_t last_commit_time;
+  /**
+   * Moving average of how long our rounds take, from begin() to
+   * commit_finish(), in seconds.
+   *
+   * Only maintained on the Leader; zero until a round completes.
+   */
+  double avg_round_latency = 0;
   /**
    * The last Proposal Number we have accepted.
    *
@@ -872,6 +880,7 @@ private:
    */
 
 
+  utime_t begin_stamp;
   utime_t commit_start_stamp;
   friend struct C_Committed;
 
@@ -1167,6 +1176,25 @@ public:
     t->append(vt);
   }
 
+  /**
+   * Fold the latency of a finished round into the moving average kept in
+   * avg_round_latency.
+   *
+   * The result is clamped to [min_wait, max_wait], so a single stalled
+   * round cannot hold the adaptive propose interval up for long.
+   *
+   * @param avg The current average, zero if no round completed yet
+   * @param round The latency of the round that just finished
+   * @param min_wait paxos_min_wait
+   * @param max_wait paxos_propose_interval
+   * @returns the new average
+   */
+  static double update_round_latency(double avg, double round,
+				     double min_wait, double max_wait) {
+    double next = avg > 0 ? 0.75 * avg + 0.25 * round : round;
+    return std::clamp(next, min_wait, std::max(min_wait, max_wait));
+  }
+
   /**
    * @todo This appears to be used only by the OSDMonitor, and I would say
    *	   its objective is to allow a third-party to have a "private"
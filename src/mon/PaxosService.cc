@@ -97,6 +97,9 @@ bool PaxosService::dispatch(MonOpRequestRef op)
     // no changes made.
     return true;
   }
+  if (pending_stamp.is_zero()) {
+    pending_stamp = ceph_clock_now();
+  }
 
   if (need_immediate_propose) {
     dout(10) << __func__ << " forced immediate propose" << dendl;
@@ -176,12 +179,16 @@ bool PaxosService::should_propose(double& delay)
   if (get_last_committed() <= 1) {
     delay = 0.0;
   } else {
+    double interval = get_propose_interval(
+      g_conf()->paxos_propose_interval,
+      g_conf()->paxos_min_wait,
+      paxos.avg_round_latency,
+      g_conf().get_val<bool>("paxos_propose_interval_adaptive"));
     utime_t now = ceph_clock_now();
-    if ((now - paxos.last_commit_time) > g_conf()->paxos_propose_interval)
+    if ((now - paxos.last_commit_time) > interval)
       delay = (double)g_conf()->paxos_min_wait;
     else
-      delay = (double)(g_conf()->paxos_propose_interval + paxos.last_commit_time
-		       - now);
+      delay = (double)(interval + paxos.last_commit_time - now);
   }
   return true;
 }
@@ -211,6 +218,7 @@ void PaxosService::propose_pending()
    *	   Paxos.
    */
   MonitorDBStore::TransactionRef t = paxos.get_pending_transaction();
+  const uint64_t bytes_before = t->get_bytes();
 
   if (should_stash_full())
     encode_full(t);
@@ -218,6 +226,20 @@ void PaxosService::propose_pending()
   encode_pending(t);
   have_pending = false;
 
+  utime_t now = ceph_clock_now();
+  propose_bytes = t->get_bytes() - bytes_before;
+  if (logger) {
+    logger->inc(l_paxos_service_propose);
+    if (!pending_stamp.is_zero()) {
+      utime_t lat = now - pending_stamp;
+      logger->tinc(l_paxos_service_pending_latency, lat);
+      logger->hinc(l_paxos_service_pending_latency_hist,
+		   lat.to_nsec(), propose_bytes);
+    }
+  }
+  pending_stamp = utime_t();
+  propose_stamp = now;
+
   if (format_version > 0) {
     t->put(get_service_name(), "format_version", format_version);
   }
@@ -240,6 +262,12 @@ void PaxosService::propose_pending()
     explicit C_Committed(PaxosService *p) : ps(p) { }
     void finish(int r) override {
       ps->proposing = false;
+      if (r >= 0 && ps->logger) {
+	utime_t lat = ceph_clock_now() - ps->propose_stamp;
+	ps->logger->tinc(l_paxos_service_commit_latency, lat);
+	ps->logger->hinc(l_paxos_service_commit_latency_hist,
+			 lat.to_nsec(), ps->propose_bytes);
+      }
       if (r >= 0)
 	ps->_active();
       else if (r == -ECANCELED || r == -EAGAIN)
@@ -252,6 +280,48 @@ void PaxosService::propose_pending()
   paxos.trigger_propose();
 }
 
+void PaxosService::init_logger()
+{
+  PerfCountersBuilder pcb(g_ceph_context, "paxos_service-" + service_name,
+			  l_paxos_service_first, l_paxos_service_last);
+
+  // latency axis, values are in nanoseconds
+  PerfHistogramCommon::axis_config_d latency_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+    0,                               ///< Start at 0
+    100000,                          ///< Quantization unit is 100usec
+    32,                              ///< Enough to cover stalled elections
+  };
+  // bytes this service added to the paxos transaction
+  PerfHistogramCommon::axis_config_d bytes_axis_config{
+    "Proposal size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Proposal size in logarithmic scale
+    0,                               ///< Start at 0
+    512,                             ///< Quantization unit is 512 bytes
+    32,                              ///< Enough to cover full osdmaps
+  };
+
+  pcb.set_prio_default(PerfCountersBuilder::PRIO_USEFUL);
+  pcb.add_u64_counter(l_paxos_service_propose, "propose", "Proposals");
+  pcb.add_time_avg(l_paxos_service_pending_latency, "pending_latency",
+		   "Time from the first pending change to its proposal");
+  pcb.add_u64_counter_histogram(
+    l_paxos_service_pending_latency_hist, "pending_latency_histogram",
+    latency_axis_config, bytes_axis_config,
+    "Histogram of the time from the first pending change to its proposal "
+    "(nanoseconds) vs. proposal size");
+  pcb.add_time_avg(l_paxos_service_commit_latency, "commit_latency",
+		   "Time from proposal to commit");
+  pcb.add_u64_counter_histogram(
+    l_paxos_service_commit_latency_hist, "commit_latency_histogram",
+    latency_axis_config, bytes_axis_config,
+    "Histogram of the time from proposal to commit (nanoseconds) vs. "
+    "proposal size");
+  logger = pcb.create_perf_counters();
+  g_ceph_context->get_perfcounters_collection()->add(logger);
+}
+
 bool PaxosService::should_stash_full()
 {
   version_t latest_full = get_version_latest_full();
@@ -20,6 +20,16 @@
 #include "Monitor.h"
 #include "MonitorDBStore.h"
 
+enum {
+  l_paxos_service_first = 45900,
+  l_paxos_service_propose,
+  l_paxos_service_pending_latency,
+  l_paxos_service_pending_latency_hist,
+  l_paxos_service_commit_latency,
+  l_paxos_service_commit_latency_hist,
+  l_paxos_service_last,
+};
+
 /**
  * A Paxos Service is an abstraction that easily allows one to obtain an
  * association between a Monitor and a Paxos class, in order to implement any
@@ -74,6 +84,16 @@ protected:
    */
   bool have_pending; 
 
+  /**
+   * When the first change went into the pending value, when we last
+   * proposed and how many bytes that proposal added to the paxos
+   * transaction; for the perf counters.
+   */
+  utime_t pending_stamp;
+  utime_t propose_stamp;
+  uint64_t propose_bytes = 0;
+  PerfCounters *logger = nullptr;
+
   /**
    * health checks for this service
    *
@@ -156,7 +176,17 @@ public:
   {
   }
 
-  virtual ~PaxosService() {}
+  virtual ~PaxosService() {
+    if (logger) {
+      g_ceph_context->get_perfcounters_collection()->remove(logger);
+      delete logger;
+    }
+  }
+
+  /**
+   * Register the perf counters of this service, as paxos_service-<name>.
+   */
+  void init_logger();
 
   /**
    * Get the service's name.
@@ -376,6 +406,29 @@ public:
    */
   virtual bool should_propose(double &delay);
 
+  /**
+   * How long to gather updates after the last commit before proposing.
+   *
+   * @param propose_interval paxos_propose_interval
+   * @param min_wait paxos_min_wait
+   * @param avg_round_latency Paxos' moving average of its round latency
+   * @param adaptive paxos_propose_interval_adaptive
+   * @returns propose_interval, or if adaptive, four rounds bounded by
+   *	      min_wait and propose_interval
+   */
+  static double get_propose_interval(double propose_interval,
+				     double min_wait,
+				     double avg_round_latency,
+				     bool adaptive) {
+    if (!adaptive || avg_round_latency <= 0) {
+      return propose_interval;
+    }
+    // rounds are serialized anyway, so gathering for much longer than one
+    // takes only delays the updates
+    return std::min(propose_interval,
+		    std::max(min_wait, 4 * avg_round_latency));
+  }
+
   /**
    * force an immediate propose.
    *
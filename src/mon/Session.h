@@ -15,9 +15,12 @@
 #ifndef CEPH_MON_SESSION_H
 #define CEPH_MON_SESSION_H
 
+#include <algorithm>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include "include/random.h"
 #include "include/utime.h"
 #include "include/xlist.h"
 
@@ -211,50 +214,29 @@ struct MonSessionMap {
     }
   }
 
-  MonSession *get_random_osd_session(OSDMap *osdmap) {
-    // ok, this isn't actually random, but close enough.
-    if (by_osd.empty())
-      return 0;
-    int n = by_osd.rbegin()->first + 1;
-    int r = rand() % n;
-
-    auto p = by_osd.lower_bound(r);
-    if (p == by_osd.end())
-      --p;
-
-    if (!osdmap) {
-      return p->second;
-    }
-
-    MonSession *s = NULL;
-
-    auto b = p;
-    auto f = p;
-    bool backward = true, forward = true;
-    while (backward || forward) {
-      if (backward) {
-        if (osdmap->is_up(b->first) &&
-	    osdmap->get_addrs(b->first) == b->second->con->get_peer_addrs()) {
-          s = b->second;
-          break;
-        }
-        if (b != by_osd.begin())
-          --b;
-        else
-          backward = false;
-      }
-
-      forward = (f != by_osd.end());
-      if (forward) {
-        if (osdmap->is_up(f->first)) {
-          s = f->second;
-          break;
-        }
-        ++f;
+  /**
+   * Pick up to n sessions of distinct osds that are up in osdmap, at
+   * random.
+   */
+  std::vector<MonSession*> get_random_osd_sessions(const OSDMap &osdmap,
+						   size_t n) {
+    std::vector<MonSession*> up;
+    int last = -1;
+    for (auto& [osd, s] : by_osd) {
+      if (osd != last &&
+	  osdmap.is_up(osd) &&
+	  osdmap.get_addrs(osd) == s->con->get_peer_addrs()) {
+	up.push_back(s);
+	last = osd;
       }
     }
-
-    return s;
+    n = std::min(n, up.size());
+    for (size_t i = 0; i < n; ++i) {
+      std::swap(up[i],
+		up[ceph::util::generate_random_number<size_t>(i, up.size() - 1)]);
+    }
+    up.resize(n);
+    return up;
   }
 
   void add_update_sub(MonSession *s, const std::string& what, version_t start, bool onetime, bool incremental_onetime) {
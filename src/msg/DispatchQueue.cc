@@ -12,6 +12,8 @@
  * 
  */
 
+#include <vector>
+
 #include "msg/Message.h"
 #include "DispatchQueue.h"
 #include "Messenger.h"
@@ -89,9 +91,9 @@ void DispatchQueue::enqueue(const ref_t<Message>& m, int priority, uint64_t id)
   ldout(cct,20) << "queue " << m << " prio " << priority << dendl;
   add_arrival(m);
   if (priority >= CEPH_MSG_PRIO_LOW) {
-    mqueue.enqueue_strict(id, priority, QueueItem(m));
+    mqueue.enqueue_strict(id, priority, QueueItem(m, id));
   } else {
-    mqueue.enqueue(id, priority, m->get_cost(), QueueItem(m));
+    mqueue.enqueue(id, priority, m->get_cost(), QueueItem(m, id));
   }
   cond.notify_all();
 }
@@ -155,55 +157,75 @@ void DispatchQueue::dispatch_throttle_release(uint64_t msize)
  */
 void DispatchQueue::entry()
 {
+  std::vector<QueueItem> batch;
+  batch.reserve(dispatch_batch_size);
   std::unique_lock l{lock};
   while (true) {
     while (!mqueue.empty()) {
-      QueueItem qitem = mqueue.dequeue();
-      if (!qitem.is_code())
-	remove_arrival(qitem.get_message());
+      // take a few items per trip through the lock, so that the
+      // messenger threads queueing messages contend with us less
+      while (!mqueue.empty() && batch.size() < dispatch_batch_size) {
+	batch.push_back(mqueue.dequeue());
+	if (!batch.back().is_code())
+	  remove_arrival(batch.back().get_message());
+      }
+      dispatching_batch = true;
       l.unlock();
 
-      if (qitem.is_code()) {
-	if (cct->_conf->ms_inject_internal_delays &&
-	    cct->_conf->ms_inject_delay_probability &&
-	    (rand() % 10000)/10000.0 < cct->_conf->ms_inject_delay_probability) {
-	  utime_t t;
-	  t.set_from_double(cct->_conf->ms_inject_internal_delays);
-	  ldout(cct, 1) << "DispatchQueue::entry  inject delay of " << t
-			<< dendl;
-	  t.sleep();
-	}
-	switch (qitem.get_code()) {
-	case D_BAD_REMOTE_RESET:
-	  msgr->ms_deliver_handle_remote_reset(qitem.get_connection());
-	  break;
-	case D_CONNECT:
-	  msgr->ms_deliver_handle_connect(qitem.get_connection());
-	  break;
-	case D_ACCEPT:
-	  msgr->ms_deliver_handle_accept(qitem.get_connection());
-	  break;
-	case D_BAD_RESET:
-	  msgr->ms_deliver_handle_reset(qitem.get_connection());
-	  break;
-	case D_CONN_REFUSED:
-	  msgr->ms_deliver_handle_refused(qitem.get_connection());
-	  break;
-	default:
-	  ceph_abort();
-	}
-      } else {
-	const ref_t<Message>& m = qitem.get_message();
-	if (stop) {
-	  ldout(cct,10) << " stop flag set, discarding " << m << " " << *m << dendl;
+      for (auto& qitem : batch) {
+	if (qitem.is_code()) {
+	  if (cct->_conf->ms_inject_internal_delays &&
+	      cct->_conf->ms_inject_delay_probability &&
+	      (rand() % 10000)/10000.0 < cct->_conf->ms_inject_delay_probability) {
+	    utime_t t;
+	    t.set_from_double(cct->_conf->ms_inject_internal_delays);
+	    ldout(cct, 1) << "DispatchQueue::entry  inject delay of " << t
+			  << dendl;
+	    t.sleep();
+	  }
+	  switch (qitem.get_code()) {
+	  case D_BAD_REMOTE_RESET:
+	    msgr->ms_deliver_handle_remote_reset(qitem.get_connection());
+	    break;
+	  case D_CONNECT:
+	    msgr->ms_deliver_handle_connect(qitem.get_connection());
+	    break;
+	  case D_ACCEPT:
+	    msgr->ms_deliver_handle_accept(qitem.get_connection());
+	    break;
+	  case D_BAD_RESET:
+	    msgr->ms_deliver_handle_reset(qitem.get_connection());
+	    break;
+	  case D_CONN_REFUSED:
+	    msgr->ms_deliver_handle_refused(qitem.get_connection());
+	    break;
+	  default:
+	    ceph_abort();
+	  }
 	} else {
-	  uint64_t msize = pre_dispatch(m);
-	  msgr->ms_deliver_dispatch(m);
-	  post_dispatch(m, msize);
+	  const ref_t<Message>& m = qitem.get_message();
+	  if (stop) {
+	    ldout(cct,10) << " stop flag set, discarding " << m << " " << *m << dendl;
+	  } else if (discarded_from_batch(qitem.get_id())) {
+	    // the connection was reset since we took m off the queue
+	    ldout(cct,10) << " queue discarded, dropping " << m << " " << *m
+			  << dendl;
+	    dispatch_throttle_release(m->get_dispatch_throttle_size());
+	  } else {
+	    uint64_t msize = pre_dispatch(m);
+	    msgr->ms_deliver_dispatch(m);
+	    post_dispatch(m, msize);
+	  }
 	}
       }
+      batch.clear();
 
       l.lock();
+      dispatching_batch = false;
+      if (batch_discard_pending) {
+	batch_discarded.clear();
+	batch_discard_pending = false;
+      }
     }
     if (stop)
       break;
@@ -223,6 +245,10 @@ void DispatchQueue::discard_queue(uint64_t id) {
     remove_arrival(m);
     dispatch_throttle_release(m->get_dispatch_throttle_size());
   }
+  if (dispatching_batch) {
+    batch_discarded.insert(id);
+    batch_discard_pending = true;
+  }
 }
 
 void DispatchQueue::start()
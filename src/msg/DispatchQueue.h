@@ -15,9 +15,11 @@
 #ifndef CEPH_DISPATCHQUEUE_H
 #define CEPH_DISPATCHQUEUE_H
 
+#include <algorithm>
 #include <atomic>
 #include <map>
 #include <queue>
+#include <set>
 #include <boost/intrusive_ptr.hpp>
 #include "include/ceph_assert.h"
 #include "include/common_fwd.h"
@@ -42,8 +44,10 @@ class DispatchQueue {
     int type;
     ConnectionRef con;
     ceph::ref_t<Message> m;
+    uint64_t id = 0;
   public:
-    explicit QueueItem(const ceph::ref_t<Message>& m) : type(-1), con(0), m(m) {}
+    QueueItem(const ceph::ref_t<Message>& m, uint64_t id)
+      : type(-1), con(0), m(m), id(id) {}
     QueueItem(int type, Connection *con) : type(type), con(con), m(0) {}
     bool is_code() const {
       return type != -1;
@@ -60,6 +64,9 @@ class DispatchQueue {
       ceph_assert(is_code());
       return con.get();
     }
+    uint64_t get_id() const {
+      return id;
+    }
   };
 
   CephContext *cct;
@@ -69,21 +76,33 @@ class DispatchQueue {
 
   PrioritizedQueue<QueueItem, uint64_t> mqueue;
 
-  std::set<std::pair<double, ceph::ref_t<Message>>> marrival;
-  std::map<ceph::ref_t<Message>, decltype(marrival)::iterator> marrival_map;
+  // queued messages by arrival; mqueue holds the references.  The
+  // recv stamp of a message does not change while it is queued, so
+  // (stamp, message) is enough to find it again.
+  std::set<std::pair<double, const Message*>> marrival;
   void add_arrival(const ceph::ref_t<Message>& m) {
-    marrival_map.insert(
-      make_pair(
-	m,
-	marrival.insert(std::make_pair(m->get_recv_stamp(), m)).first
-	)
-      );
+    marrival.emplace(m->get_recv_stamp(), m.get());
   }
   void remove_arrival(const ceph::ref_t<Message>& m) {
-    auto it = marrival_map.find(m);
-    ceph_assert(it != marrival_map.end());
-    marrival.erase(it->second);
-    marrival_map.erase(it);
+    [[maybe_unused]] auto n =
+      marrival.erase(std::make_pair(double(m->get_recv_stamp()), m.get()));
+    ceph_assert(n == 1);
+  }
+
+  /// items dispatched per trip through the lock, see ms_dispatch_batch_size
+  const unsigned dispatch_batch_size;
+  /// entry() has a batch out of mqueue, protected by lock
+  bool dispatching_batch = false;
+  /// queues discarded while a batch was out; their messages in the
+  /// batch that are not dispatched yet are dropped as well
+  std::set<uint64_t> batch_discarded;
+  std::atomic<bool> batch_discard_pending = false;
+  bool discarded_from_batch(uint64_t id) {
+    if (!batch_discard_pending) {
+      return false;
+    }
+    std::lock_guard l{lock};
+    return batch_discarded.count(id);
   }
 
   std::atomic<uint64_t> next_id;
@@ -223,6 +242,8 @@ class DispatchQueue {
       lock(ceph::make_mutex("Messenger::DispatchQueue::lock" + name)),
       mqueue(cct->_conf->ms_pq_max_tokens_per_priority,
 	     cct->_conf->ms_pq_min_cost),
+      dispatch_batch_size(std::max<uint64_t>(
+	1, cct->_conf.get_val<uint64_t>("ms_dispatch_batch_size"))),
       next_id(1),
       dispatch_thread(this),
       local_delivery_lock(ceph::make_mutex("Messenger::DispatchQueue::local_delivery_lock" + name)),
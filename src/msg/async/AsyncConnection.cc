@@ -333,6 +333,7 @@ ssize_t AsyncConnection::_try_send(bool more)
   ssize_t r = 0;
   if (likely(!inject_network_congestion())) {
     r = cs.send(outgoing_bl, more);
+    logger->inc(l_msgr_send_calls);
   }
   if (r < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " send error: " << cpp_strerror(r) << dendl;
@@ -71,6 +71,7 @@ int Processor::bind(const entity_addrvec_t &bind_addrs,
   opts.nodelay = msgr->cct->_conf->ms_tcp_nodelay;
   opts.rcbuf_size = msgr->cct->_conf->ms_tcp_rcvbuf;
 
+  listen_sockets.clear();
   listen_sockets.resize(bind_addrs.v.size());
   *bound_addrs = bind_addrs;
 
@@ -145,6 +146,25 @@ int Processor::bind(const entity_addrvec_t &bind_addrs,
     }
   }
 
+  if (!conf.get_val<std::string>("ms_local_socket_dir").empty()) {
+    for (unsigned k = 0; k < bound_addrs->v.size(); ++k) {
+      ServerSocket local_socket;
+      int r;
+      worker->center.submit_to(
+	worker->center.get_id(),
+	[this, k, bound_addrs, &opts, &local_socket, &r]() {
+	  r = worker->listen_local(bound_addrs->v[k], k, opts, &local_socket);
+	}, false);
+      if (r == 0) {
+	listen_sockets.push_back(std::move(local_socket));
+      } else {
+	ldout(msgr->cct, 1) << __func__ << " not accepting same-host connections"
+			    << " to " << bound_addrs->v[k] << ": "
+			    << cpp_strerror(r) << dendl;
+      }
+    }
+  }
+
   ldout(msgr->cct, 10) << __func__ << " bound to " << *bound_addrs << dendl;
   return 0;
 }
@@ -194,6 +214,31 @@ void Processor::accept()
 	ldout(msgr->cct, 10) << __func__ << " accepted incoming on sd "
 			     << cli_socket.fd() << dendl;
 
+#ifdef SO_INCOMING_CPU
+	if (!msgr->get_stack()->support_local_listen_table()) {
+	  // serve the connection on the worker pinned to the cpu the
+	  // kernel processes its packets on, or to another cpu of its
+	  // numa node, if there is one
+	  int cpu = -1;
+	  socklen_t len = sizeof(cpu);
+	  if (::getsockopt(cli_socket.fd(), SOL_SOCKET, SO_INCOMING_CPU,
+			   &cpu, &len) == 0) {
+	    auto stack = msgr->get_stack();
+	    if (Worker *cw = stack->get_worker_for_cpu(
+		  cpu, stack->get_cpu_numa_node(cpu));
+		cw && cw != w) {
+	      ldout(msgr->cct, 20) << __func__ << " incoming cpu " << cpu
+				   << ", moving sd " << cli_socket.fd()
+				   << " to worker " << cw->id << dendl;
+	      --w->references;
+	      w = cw;
+	    } else if (cw) {
+	      --cw->references;
+	    }
+	  }
+	}
+#endif
+
 	msgr->add_accept(
 	  w, std::move(cli_socket),
 	  msgr->get_myaddrs().v[listen_socket.get_addr_slot()],
@@ -18,9 +18,17 @@
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
 #include <errno.h>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
 
 #include <algorithm>
+#include <deque>
 
 #include "PosixStack.h"
 
@@ -37,16 +45,56 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   ceph::NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
+  // sends of at least this many bytes use MSG_ZEROCOPY; 0 if disabled
+  size_t zerocopy_min_size;
+  // the kernel numbers our MSG_ZEROCOPY sendmsg calls, this is the next
+  uint32_t zerocopy_next = 0;
+  // what we sent with MSG_ZEROCOPY, which the kernel may still be
+  // reading, with the number of the last sendmsg that used it
+  struct zerocopy_send_t {
+    uint32_t last;
+    bool done = false;
+    ceph::buffer::list bl;
+    zerocopy_send_t(uint32_t last, ceph::buffer::list&& bl)
+      : last(last), bl(std::move(bl)) {}
+  };
+  std::deque<zerocopy_send_t> zerocopy_pending;
 
  public:
   explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
-				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+				    int f, bool connected,
+				    size_t zerocopy_min_size = 0)
+      : handler(h), _fd(f), sa(sa), connected(connected),
+	zerocopy_min_size(zerocopy_min_size) {}
+
+  // turn on MSG_ZEROCOPY for a socket if the config asks for it;
+  // returns the minimum size of a zerocopy send, or 0
+  static size_t enable_zerocopy(CephContext *cct, int sd) {
+#ifdef HAVE_MSG_ZEROCOPY
+    if (!cct->_conf.get_val<bool>("ms_tcp_zerocopy")) {
+      return 0;
+    }
+    int one = 1;
+    if (::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+      int r = ceph_sock_errno();
+      ldout(cct, 1) << "couldn't set SO_ZEROCOPY: " << cpp_strerror(r) << dendl;
+      return 0;
+    }
+    return std::max<size_t>(
+      1, cct->_conf.get_val<Option::size_t>("ms_tcp_zerocopy_min_size"));
+#else
+    return 0;
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -63,7 +111,55 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     }
   }
 
+  // release the buffers of the MSG_ZEROCOPY sends the kernel is done with
+  void reap_zerocopy() {
+#ifdef HAVE_MSG_ZEROCOPY
+    while (!zerocopy_pending.empty()) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 4];
+      struct msghdr msg;
+      // FIPS zeroization audit 20191115: this memset is not security related.
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+	break;
+      }
+      for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+	  continue;
+	}
+	auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+	if (serr->ee_errno != 0 ||
+	    serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+	  continue;
+	}
+#ifdef SO_EE_CODE_ZEROCOPY_COPIED
+	// the kernel copied the data anyway (loopback, or a device
+	// without scatter-gather), so the notifications are pure cost
+	if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+	  zerocopy_min_size = 0;
+	}
+#endif
+	// sends [ee_info, ee_data] are done; the numbers wrap around
+	uint32_t lo = serr->ee_info, hi = serr->ee_data;
+	for (auto& p : zerocopy_pending) {
+	  if (p.last - lo <= hi - lo) {
+	    p.done = true;
+	  }
+	}
+      }
+      while (!zerocopy_pending.empty() && zerocopy_pending.front().done) {
+	zerocopy_pending.pop_front();
+      }
+    }
+#endif
+  }
+
   ssize_t read(char *buf, size_t len) override {
+    // completions are queued on the socket error queue, which wakes up
+    // the reader through EPOLLERR
+    reap_zerocopy();
     #ifdef _WIN32
     ssize_t r = ::recv(_fd, buf, len, 0);
     #else
@@ -77,22 +173,38 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   // return the sent length
   // < 0 means error occurred
   #ifndef _WIN32
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  //
+  // with zerocopy set, *zerocopy_sends counts the sendmsg calls that
+  // used MSG_ZEROCOPY.
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    bool zerocopy = false,
+			    uint32_t *zerocopy_sends = nullptr)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy)
+	flags |= MSG_ZEROCOPY;
+#endif
+      r = ::sendmsg(fd, &msg, flags);
       if (r < 0) {
         int err = ceph_sock_errno();
         if (err == EINTR) {
           continue;
         } else if (err == EAGAIN) {
           break;
-        }
+        } else if (err == ENOBUFS && zerocopy) {
+	  // out of notification space (optmem_max), copy this time
+	  zerocopy = false;
+	  continue;
+	}
         return -err;
       }
+      if (zerocopy)
+	++*zerocopy_sends;
 
       sent += r;
       if (len == sent) break;
@@ -114,6 +226,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(ceph::buffer::list &bl, bool more) override {
+    reap_zerocopy();
+    bool zerocopy = zerocopy_min_size && bl.length() >= zerocopy_min_size;
+    uint32_t zerocopy_sends = 0;
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
@@ -133,9 +248,16 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
-      if (r < 0)
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more,
+			     zerocopy, &zerocopy_sends);
+      if (r < 0) {
+	if (zerocopy_sends) {
+	  // the kernel may still read what the earlier batches sent
+	  zerocopy_next += zerocopy_sends;
+	  zerocopy_pending.emplace_back(zerocopy_next - 1, ceph::buffer::list(bl));
+	}
         return r;
+      }
 
       // "r" is the remaining length
       sent_bytes += r;
@@ -150,7 +272,12 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
         bl.swap(swapped);
       } else {
-        bl.clear();
+        swapped.swap(bl);
+      }
+      // swapped now holds what went out
+      if (zerocopy_sends) {
+	zerocopy_next += zerocopy_sends;
+	zerocopy_pending.emplace_back(zerocopy_next - 1, std::move(swapped));
       }
     }
 
@@ -204,6 +331,14 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     ::shutdown(_fd, SHUT_RDWR);
   }
   void close() override {
+    reap_zerocopy();
+    if (!zerocopy_pending.empty()) {
+      // a graceful close would still send what is queued, reading pages
+      // we are about to free; reset the connection so the kernel drops it
+      struct linger l = {1, 0};
+      ::setsockopt(_fd, SOL_SOCKET, SO_LINGER, (char*)&l, sizeof(l));
+      zerocopy_pending.clear();
+    }
     compat_closesocket(_fd);
   }
   void set_priority(int sd, int prio, int domain) override {
@@ -219,16 +354,34 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 class PosixServerSocketImpl : public ServerSocketImpl {
   ceph::NetHandler &handler;
   int _fd;
+  // set if this is the unix socket for same-host peers of listen_addr
+  const entity_addr_t listen_addr;
+  const std::string local_path;
+  // the inode we bound at local_path
+  const dev_t local_dev;
+  const ino_t local_ino;
 
  public:
   explicit PosixServerSocketImpl(ceph::NetHandler &h, int f,
-				 const entity_addr_t& listen_addr, unsigned slot)
+				 const entity_addr_t& listen_addr, unsigned slot,
+				 const std::string& local_path = {},
+				 dev_t local_dev = 0, ino_t local_ino = 0)
     : ServerSocketImpl(listen_addr.get_type(), slot),
-      handler(h), _fd(f) {}
+      handler(h), _fd(f), listen_addr(listen_addr), local_path(local_path),
+      local_dev(local_dev), local_ino(local_ino) {}
   int accept(ConnectedSocket *sock, const SocketOptions &opts, entity_addr_t *out, Worker *w) override;
   void abort_accept() override {
     ::close(_fd);
     _fd = -1;
+#ifndef _WIN32
+    // leave it alone if another listener has taken the path over since
+    struct stat st;
+    if (!local_path.empty() &&
+	::stat(local_path.c_str(), &st) == 0 &&
+	st.st_dev == local_dev && st.st_ino == local_ino) {
+      ::unlink(local_path.c_str());
+    }
+#endif
   }
   int fd() const override {
     return _fd;
@@ -250,19 +403,38 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
     return -ceph_sock_errno();
   }
 
+  ceph_assert(NULL != out); //out should not be NULL in accept connection
+
+  if (!local_path.empty()) {
+    // the peer is on this host, so as far as addresses go it may as
+    // well have connected to our ip
+    r = handler.set_socket_options(sd, false, opt.rcbuf_size);
+    if (r < 0) {
+      ::close(sd);
+      return r;
+    }
+    *out = listen_addr;
+    out->set_port(0);
+    std::unique_ptr<PosixConnectedSocketImpl> csi(
+      new PosixConnectedSocketImpl(handler, *out, sd, true));
+    *sock = ConnectedSocket(std::move(csi));
+    return 0;
+  }
+
   r = handler.set_socket_options(sd, opt.nodelay, opt.rcbuf_size);
   if (r < 0) {
     ::close(sd);
     return -ceph_sock_errno();
   }
 
-  ceph_assert(NULL != out); //out should not be NULL in accept connection
-
   out->set_type(addr_type);
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  size_t zerocopy_min_size =
+    PosixConnectedSocketImpl::enable_zerocopy(w->cct, sd);
+  std::unique_ptr<PosixConnectedSocketImpl> csi(
+    new PosixConnectedSocketImpl(handler, *out, sd, true, zerocopy_min_size));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -316,8 +488,160 @@ int PosixWorker::listen(entity_addr_t &sa,
   return 0;
 }
 
+// The unix socket a messenger listening on addr accepts same-host
+// connections on, if ms_local_socket_dir is set.
+static std::string local_socket_path(CephContext *cct,
+				     const entity_addr_t &addr)
+{
+#ifndef _WIN32
+  const auto dir = cct->_conf.get_val<std::string>("ms_local_socket_dir");
+  if (!dir.empty() && !addr.is_blank_ip()) {
+    return dir + "/msgr-" + addr.ip_n_port_to_str() + ".sock";
+  }
+#endif
+  return {};
+}
+
+int PosixWorker::listen_local(entity_addr_t &sa,
+			      unsigned addr_slot,
+			      const SocketOptions &opt,
+			      ServerSocket *sock)
+{
+#ifndef _WIN32
+  const std::string path = local_socket_path(cct, sa);
+  sockaddr_un sun = {};
+  if (path.empty()) {
+    return -EOPNOTSUPP;
+  }
+  if (path.size() >= sizeof(sun.sun_path)) {
+    return -ENAMETOOLONG;
+  }
+  sun.sun_family = AF_UNIX;
+  path.copy(sun.sun_path, path.size());
+
+  int listen_sd = net.create_socket(AF_UNIX);
+  if (listen_sd < 0) {
+    return listen_sd;
+  }
+
+  int r = net.set_nonblock(listen_sd);
+  if (r < 0) {
+    ::close(listen_sd);
+    return r;
+  }
+
+  // a previous instance listening on the same address may have left
+  // its socket behind; remove it only if nobody accepts on it any more
+  if (::access(path.c_str(), F_OK) == 0) {
+    int sd = net.create_socket(AF_UNIX);
+    if (sd < 0) {
+      ::close(listen_sd);
+      return sd;
+    }
+    r = net.set_nonblock(sd);
+    if (r == 0 &&
+	::connect(sd, reinterpret_cast<sockaddr*>(&sun), sizeof(sun)) < 0) {
+      r = -ceph_sock_errno();
+    }
+    ::close(sd);
+    if (r == -ECONNREFUSED) {
+      ldout(cct, 10) << __func__ << " removing stale " << path << dendl;
+      ::unlink(path.c_str());
+    } else if (r != -ENOENT) {
+      // connected, or a full backlog: somebody is listening there
+      if (r == 0 || r == -EAGAIN) {
+	r = -EADDRINUSE;
+      }
+      ldout(cct, 10) << __func__ << " not replacing " << path
+		    << ": " << cpp_strerror(r) << dendl;
+      ::close(listen_sd);
+      return r;
+    }
+  }
+  r = ::bind(listen_sd, reinterpret_cast<sockaddr*>(&sun), sizeof(sun));
+  if (r < 0) {
+    r = -ceph_sock_errno();
+    ldout(cct, 1) << __func__ << " unable to bind to " << path
+		  << ": " << cpp_strerror(r) << dendl;
+    ::close(listen_sd);
+    return r;
+  }
+  struct stat st;
+  if (::stat(path.c_str(), &st) < 0) {
+    r = -errno;
+    ldout(cct, 1) << __func__ << " unable to stat " << path
+		  << ": " << cpp_strerror(r) << dendl;
+    ::close(listen_sd);
+    return r;
+  }
+
+  r = ::listen(listen_sd, cct->_conf->ms_tcp_listen_backlog);
+  if (r < 0) {
+    r = -ceph_sock_errno();
+    lderr(cct) << __func__ << " unable to listen on " << path << ": "
+	       << cpp_strerror(r) << dendl;
+    ::close(listen_sd);
+    ::unlink(path.c_str());
+    return r;
+  }
+
+  ldout(cct, 10) << __func__ << " accepting same-host connections to " << sa
+		 << " on " << path << dendl;
+  *sock = ServerSocket(
+          std::unique_ptr<PosixServerSocketImpl>(
+	    new PosixServerSocketImpl(net, listen_sd, sa, addr_slot, path,
+				      st.st_dev, st.st_ino)));
+  return 0;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
+int PosixWorker::connect_local(const entity_addr_t &addr)
+{
+#ifndef _WIN32
+  const std::string path = local_socket_path(cct, addr);
+  sockaddr_un sun = {};
+  if (path.empty() || path.size() >= sizeof(sun.sun_path) ||
+      ::access(path.c_str(), F_OK) < 0) {
+    return -ENOENT;
+  }
+  sun.sun_family = AF_UNIX;
+  path.copy(sun.sun_path, path.size());
+
+  int sd = net.create_socket(AF_UNIX);
+  if (sd < 0) {
+    return sd;
+  }
+  int r = net.set_nonblock(sd);
+  if (r == 0 &&
+      ::connect(sd, reinterpret_cast<sockaddr*>(&sun), sizeof(sun)) < 0) {
+    // a stale socket, or a full backlog: let tcp deal with it
+    r = -ceph_sock_errno();
+  }
+  if (r < 0) {
+    ldout(cct, 10) << __func__ << " unable to connect to " << path << ": "
+		   << cpp_strerror(r) << dendl;
+    ::close(sd);
+    return r;
+  }
+  net.set_socket_options(sd, false, cct->_conf->ms_tcp_rcvbuf);
+  ldout(cct, 10) << __func__ << " connected to " << addr << " through "
+		 << path << dendl;
+  return sd;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
 int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, ConnectedSocket *socket) {
-  int sd;
+  int sd = connect_local(addr);
+  if (sd >= 0) {
+    *socket = ConnectedSocket(
+      std::unique_ptr<PosixConnectedSocketImpl>(
+	new PosixConnectedSocketImpl(net, addr, sd, true)));
+    return 0;
+  }
 
   if (opts.nonblock) {
     sd = net.nonblock_connect(addr, opts.connect_bind_addr);
@@ -330,8 +654,11 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
   }
 
   net.set_priority(sd, opts.priority, addr.get_family());
+  size_t zerocopy_min_size = PosixConnectedSocketImpl::enable_zerocopy(cct, sd);
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(
+	new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock,
+				     zerocopy_min_size)));
   return 0;
 }
 
@@ -34,7 +34,15 @@ class PosixWorker : public Worker {
 	     unsigned addr_slot,
 	     const SocketOptions &opt,
 	     ServerSocket *socks) override;
+  int listen_local(entity_addr_t &sa,
+		   unsigned addr_slot,
+		   const SocketOptions &opt,
+		   ServerSocket *sock) override;
   int connect(const entity_addr_t &addr, const SocketOptions &opts, ConnectedSocket *socket) override;
+
+ private:
+  // connect to a same-host peer through its unix socket, if it has one
+  int connect_local(const entity_addr_t &addr);
 };
 
 class PosixNetworkStack : public NetworkStack {
@@ -1428,7 +1428,9 @@ CtPtr ProtocolV1::handle_server_banner_and_identify(char *buffer, int r) {
     socklen_t len = sizeof(ss);
     getsockname(connection->cs.fd(), (sockaddr *)&ss, &len);
     entity_addr_t a;
-    if (cct->_conf->ms_learn_addr_from_peer) {
+    // a unix socket to a same-host peer has no ip for us to learn
+    if (cct->_conf->ms_learn_addr_from_peer ||
+	(ss.ss_family != AF_INET && ss.ss_family != AF_INET6)) {
       ldout(cct, 1) << __func__ << " peer " << connection->target_addr
 		    << " says I am " << peer_addr_for_me << " (socket says "
 		    << (sockaddr*)&ss << ")" << dendl;
@@ -100,6 +100,7 @@ ProtocolV2::ProtocolV2(AsyncConnection *connection)
                    &session_compression_handlers),
       rx_frame_asm(&session_stream_handlers, false, cct->_conf->ms_crc_data,
                    &session_compression_handlers),
+      send_batch_size(cct->_conf.get_val<Option::size_t>("ms_send_batch_size")),
       next_tag(static_cast<Tag>(0)),
       keepalive(false) {
 }
@@ -556,6 +557,12 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " src=" << entity_name_t(messenger->get_myname())
                  << " off=" << header2.data_off
                  << dendl;
+  if (more && connection->outgoing_bl.length() < send_batch_size) {
+    // more messages are queued; let write_event() send them together
+    ldout(cct, 20) << __func__ << " batching " << m << dendl;
+    m->put();
+    return 0;
+  }
   ssize_t total_send_size = connection->outgoing_bl.length();
   ssize_t rc = connection->_try_send(more);
   if (rc < 0) {
@@ -625,6 +632,10 @@ void ProtocolV2::handle_message_ack(uint64_t seq) {
 
 void ProtocolV2::reset_compression() {
   ldout(cct, 5) << __func__ << dendl;
+  if (session_compression_handlers.tx) {
+    ldout(cct, 5) << __func__ << " tx "
+		  << session_compression_handlers.tx->get_stats() << dendl;
+  }
 
   comp_meta = CompConnectionMeta{};
   session_compression_handlers.rx.reset(nullptr);
@@ -653,7 +664,10 @@ void ProtocolV2::write_event() {
     auto start = ceph::mono_clock::now();
     bool more;
     do {
-      if (connection->is_queued()) {
+      // leftovers from an earlier partial send, or messages batched
+      // by write_message()
+      if (connection->is_queued() &&
+	  connection->outgoing_bl.length() >= send_batch_size) {
 	if (r = connection->_try_send(); r!= 0) {
 	  // either fails to send or not all queued buffer is sent
 	  break;
@@ -715,7 +729,12 @@ void ProtocolV2::write_event() {
           r = -EILSEQ;
         }
       } else if (is_queued()) {
+        uint64_t queued = connection->outgoing_bl.length();
         r = connection->_try_send();
+        if (r >= 0) {
+          connection->logger->inc(
+            l_msgr_send_bytes, queued - connection->outgoing_bl.length());
+        }
       }
     }
     connection->write_lock.unlock();
@@ -1028,7 +1047,9 @@ CtPtr ProtocolV2::handle_hello(ceph::bufferlist &payload)
   if (messenger->get_myaddrs().empty() ||
       messenger->get_myaddrs().front().is_blank_ip()) {
     entity_addr_t a;
-    if (cct->_conf->ms_learn_addr_from_peer) {
+    // a unix socket to a same-host peer has no ip for us to learn
+    if (cct->_conf->ms_learn_addr_from_peer ||
+	(ss.ss_family != AF_INET && ss.ss_family != AF_INET6)) {
       ldout(cct, 1) << __func__ << " peer " << connection->target_addr
 		    << " says I am " << hello.peer_addr() << " (socket says "
 		    << (sockaddr*)&ss << ")" << dendl;
@@ -1178,16 +1199,76 @@ CtPtr ProtocolV2::read_frame_segment() {
   ldout(cct, 20) << __func__ << " seg_idx=" << seg_idx << dendl;
   rx_segments_data.emplace_back();
 
+  // The header, front and middle of a message are small and each of
+  // them used to get its own allocation.  Read all of the small
+  // segments of a frame into one buffer instead; the data segment,
+  // which the sender wants page aligned, still gets its own.
+  auto use_segment_slab = [this](size_t i) {
+    uint32_t len = rx_frame_asm.get_segment_onwire_len(i);
+    return len > 0 && len <= RX_SEGMENT_SLAB_MAX_LEN &&
+      rx_frame_asm.get_segment_align(i) <= segment_t::DEFAULT_ALIGNMENT;
+  };
+  if (seg_idx == 0) {
+    rx_segment_slab = ceph::bufferptr();
+    unsigned slab_len = 0;
+    unsigned num_slab_segments = 0;
+    for (size_t i = 0; i < rx_frame_asm.get_num_segments(); i++) {
+      if (use_segment_slab(i)) {
+        slab_len += p2roundup<unsigned>(rx_frame_asm.get_segment_onwire_len(i),
+                                        segment_t::DEFAULT_ALIGNMENT);
+        ++num_slab_segments;
+      }
+    }
+    if (num_slab_segments > 1) {
+      rx_segment_slab = ceph::buffer::create_aligned(
+        slab_len, segment_t::DEFAULT_ALIGNMENT);
+    }
+  }
+
   uint32_t onwire_len = rx_frame_asm.get_segment_onwire_len(seg_idx);
   if (onwire_len == 0) {
     return _handle_read_frame_segment();
   }
 
   rx_buffer_t rx_buffer;
+  if (rx_segment_slab.length() > 0 && use_segment_slab(seg_idx)) {
+    rx_buffer = ceph::buffer::ptr_node::create(rx_segment_slab, 0, onwire_len);
+    unsigned used = p2roundup<unsigned>(onwire_len,
+                                        segment_t::DEFAULT_ALIGNMENT);
+    if (used == rx_segment_slab.length()) {
+      rx_segment_slab = ceph::bufferptr();
+    } else {
+      rx_segment_slab.set_offset(rx_segment_slab.offset() + used);
+      rx_segment_slab.set_length(rx_segment_slab.length() - used);
+    }
+    return READ_RXBUF(std::move(rx_buffer), handle_read_frame_segment);
+  }
+
   uint16_t align = rx_frame_asm.get_segment_align(seg_idx);
+  // Like msgr1, lay the data out the way the sender asked for with
+  // data_off, e.g. so that the payload of a replicated write ends up
+  // page aligned inside the encoded transaction and the objectstore
+  // does not have to copy it to realign.  The header is only readable
+  // at this point when the frame is not encrypted.
+  unsigned head = 0;
+  if (next_tag == Tag::MESSAGE &&
+      seg_idx == SegmentIndex::Msg::DATA &&
+      !session_stream_handlers.rx &&
+      align % CEPH_PAGE_SIZE == 0 &&
+      rx_segments_data[SegmentIndex::Msg::HEADER].length() ==
+        sizeof(ceph_msg_header2)) {
+    ceph_msg_header2 header;
+    rx_segments_data[SegmentIndex::Msg::HEADER].begin().copy(
+      sizeof(header), reinterpret_cast<char*>(&header));
+    head = header.data_off & ~CEPH_PAGE_MASK;
+  }
   try {
     rx_buffer = ceph::buffer::ptr_node::create(ceph::buffer::create_aligned(
-        onwire_len, align));
+        head + onwire_len, align));
+    if (head) {
+      rx_buffer->set_offset(head);
+      rx_buffer->set_length(onwire_len);
+    }
   } catch (const ceph::buffer::bad_alloc&) {
     // Catching because of potential issues with satisfying alignment.
     ldout(cct, 1) << __func__ << " can't allocate aligned rx_buffer"
@@ -105,9 +105,15 @@ private:
   ceph::msgr::v2::FrameAssembler tx_frame_asm;
   ceph::msgr::v2::FrameAssembler rx_frame_asm;
 
+  // see ms_send_batch_size
+  const uint64_t send_batch_size;
+
   ceph::bufferlist rx_preamble;
   ceph::bufferlist rx_epilogue;
   ceph::msgr::v2::segment_bls_t rx_segments_data;
+  // backs the small segments of the frame being read
+  ceph::bufferptr rx_segment_slab;
+  static constexpr uint32_t RX_SEGMENT_SLAB_MAX_LEN = 4096;
   ceph::msgr::v2::Tag next_tag;
   utime_t backoff;  // backoff time
   utime_t recv_stamp;
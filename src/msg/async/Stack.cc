@@ -15,10 +15,12 @@
  */
 
 #include <mutex>
+#include <unistd.h>
 
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/numa.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
@@ -38,6 +40,23 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
 {
   return [this, w]() {
       rename_thread(w->id);
+#ifdef __linux__
+      if (w->cpu >= 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(w->cpu, &cpu_set);
+        int r = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set),
+                                       &cpu_set);
+        if (r) {
+          lderr(cct) << __func__ << " failed to pin worker " << w->id
+                     << " to cpu " << w->cpu << ": " << cpp_strerror(r)
+                     << dendl;
+        } else {
+          ldout(cct, 10) << __func__ << " pinned worker " << w->id
+                         << " to cpu " << w->cpu << dendl;
+        }
+      }
+#endif
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
@@ -92,9 +111,37 @@ std::shared_ptr<NetworkStack> NetworkStack::create(CephContext *c,
                   << dendl;
     num_workers = EventCenter::MAX_EVENTCENTER;
   }
+  std::vector<int> cpus;
+  if (auto affinity = c->_conf.get_val<std::string>("ms_async_affinity_cores");
+      !affinity.empty()) {
+    size_t cpu_set_size;
+    cpu_set_t cpu_set;
+    if (int r = parse_cpu_set_list(affinity.c_str(), &cpu_set_size, &cpu_set);
+        r < 0) {
+      lderr(c) << __func__ << " unable to parse ms_async_affinity_cores '"
+               << affinity << "': " << cpp_strerror(r) << dendl;
+    } else {
+      auto cpu_ids = cpu_set_to_set(cpu_set_size, &cpu_set);
+      cpus.assign(cpu_ids.begin(), cpu_ids.end());
+    }
+  }
+#ifdef __linux__
+  if (!cpus.empty()) {
+    // connections arriving on a cpu without a worker of its own go to
+    // a worker on the same node
+    long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (int cpu = 0; cpu < num_cpus; ++cpu) {
+      stack->cpu_numa_nodes.push_back(std::max(-1, ::get_cpu_numa_node(cpu)));
+    }
+  }
+#endif
   const int InitEventNumber = 5000;
   for (unsigned worker_id = 0; worker_id < num_workers; ++worker_id) {
     Worker *w = stack->create_worker(c, worker_id);
+    if (!cpus.empty()) {
+      w->cpu = cpus[worker_id % cpus.size()];
+      w->numa_node = stack->get_cpu_numa_node(w->cpu);
+    }
     int ret = w->center.init(InitEventNumber, worker_id, t);
     if (ret)
       throw std::system_error(-ret, std::generic_category());
@@ -108,6 +155,41 @@ NetworkStack::NetworkStack(CephContext *c)
   : cct(c)
 {}
 
+Worker* NetworkStack::get_worker_for_cpu(int cpu, int numa_node)
+{
+  if (cpu < 0) {
+    return nullptr;
+  }
+
+  unsigned min_load = std::numeric_limits<int>::max();
+  Worker* current_best = nullptr;
+  bool on_cpu = false;
+
+  pool_spin.lock();
+  for (Worker* worker : workers) {
+    if (worker->cpu < 0) {
+      continue;
+    }
+    // a worker on the cpu itself beats any other on its node
+    bool worker_on_cpu = worker->cpu == cpu;
+    if (!worker_on_cpu &&
+	(on_cpu || numa_node < 0 || worker->numa_node != numa_node)) {
+      continue;
+    }
+    unsigned worker_load = worker->references.load();
+    if (worker_on_cpu > on_cpu || worker_load < min_load) {
+      current_best = worker;
+      min_load = worker_load;
+      on_cpu = worker_on_cpu;
+    }
+  }
+  pool_spin.unlock();
+  if (current_best) {
+    ++current_best->references;
+  }
+  return current_best;
+}
+
 void NetworkStack::start()
 {
   std::unique_lock<decltype(pool_spin)> lk(pool_spin);
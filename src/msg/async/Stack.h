@@ -197,6 +197,7 @@ enum {
   l_msgr_send_messages,
   l_msgr_recv_bytes,
   l_msgr_send_bytes,
+  l_msgr_send_calls,
   l_msgr_created_connections,
   l_msgr_active_connections,
 
@@ -222,6 +223,8 @@ class Worker {
   CephContext *cct;
   PerfCounters *perf_logger;
   unsigned id;
+  int cpu = -1;  ///< pinned to this cpu, see ms_async_affinity_cores
+  int numa_node = -1;  ///< numa node of cpu
 
   std::atomic_uint references;
   EventCenter center;
@@ -240,6 +243,7 @@ class Worker {
     plb.add_u64_counter(l_msgr_send_messages, "msgr_send_messages", "Network sent messages");
     plb.add_u64_counter(l_msgr_recv_bytes, "msgr_recv_bytes", "Network received bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_bytes, "msgr_send_bytes", "Network sent bytes", NULL, 0, unit_t(UNIT_BYTES));
+    plb.add_u64_counter(l_msgr_send_calls, "msgr_send_calls", "Calls into the socket to send queued data");
     plb.add_u64_counter(l_msgr_active_connections, "msgr_active_connections", "Active connection number");
     plb.add_u64_counter(l_msgr_created_connections, "msgr_created_connections", "Created connection number");
 
@@ -263,6 +267,12 @@ class Worker {
 
   virtual int listen(entity_addr_t &addr, unsigned addr_slot,
                      const SocketOptions &opts, ServerSocket *) = 0;
+  // also accept connections to addr from peers on the same host on a
+  // cheaper endpoint, see ms_local_socket_dir
+  virtual int listen_local(entity_addr_t &addr, unsigned addr_slot,
+                           const SocketOptions &opts, ServerSocket *) {
+    return -EOPNOTSUPP;
+  }
   virtual int connect(const entity_addr_t &addr,
                       const SocketOptions &opts, ConnectedSocket *socket) = 0;
   virtual void destroy() {}
@@ -300,6 +310,8 @@ class Worker {
 class NetworkStack {
   ceph::spinlock pool_spin;
   bool started = false;
+  // numa node of each cpu, filled in if the workers are pinned
+  std::vector<int> cpu_numa_nodes;
 
   std::function<void ()> add_thread(Worker* w);
 
@@ -342,6 +354,16 @@ class NetworkStack {
   Worker *get_worker(unsigned worker_id) {
     return workers[worker_id];
   }
+  // the numa node of cpu if the workers are pinned, otherwise -1
+  int get_cpu_numa_node(int cpu) const {
+    if (cpu < 0 || cpu >= (int)cpu_numa_nodes.size()) {
+      return -1;
+    }
+    return cpu_numa_nodes[cpu];
+  }
+  // a worker pinned to cpu, otherwise one pinned to a cpu on numa_node,
+  // or nullptr if there is none
+  Worker *get_worker_for_cpu(int cpu, int numa_node);
   void drain();
   unsigned get_num_worker() const {
     return workers.size();
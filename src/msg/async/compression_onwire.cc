@@ -1,6 +1,8 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
+
 #include "compression_onwire.h"
 #include "compression_meta.h"
 #include "common/dout.h"
@@ -20,7 +22,9 @@ rxtx_t rxtx_t::create_handler_pair(
       return {std::make_unique<RxHandler>(ctx, compressor),
 	      std::make_unique<TxHandler>(ctx, compressor,
 					  comp_meta.get_mode(),
-					  compress_min_size)};
+					  compress_min_size,
+					  ctx->_conf.get_val<double>(
+					    "ms_osd_compress_required_ratio"))};
     }
   }
   return {};
@@ -35,6 +39,15 @@ std::optional<ceph::bufferlist> TxHandler::compress(const ceph::bufferlist &inpu
     return {};
   }
 
+  if (m_skip_frames > 0) {
+    // the last sampled frames were incompressible
+    --m_skip_frames;
+    ++m_stats.frames_skipped;
+    ldout(m_cct, 20) << __func__ << " backing off, " << m_skip_frames
+		     << " more frames to skip" << dendl;
+    return {};
+  }
+
   m_compress_potential -= input.length();
 
   ceph::bufferlist out;
@@ -78,9 +91,34 @@ std::optional<ceph::bufferlist> RxHandler::decompress(const ceph::bufferlist &in
   }
 }
 
-void TxHandler::done()
+bool TxHandler::done()
 {
   ldout(m_cct, 25) << __func__ << " compression ratio=" << get_ratio() << dendl;
+  if (m_onwire_size > m_init_onwire_size * m_required_ratio) {
+    // not worth it: send this frame as is and skip the next ones,
+    // longer each time we find the payload still incompressible
+    ++m_stats.frames_incompressible;
+    m_backoff = std::min(std::max(m_backoff * 2, 1u), MAX_BACKOFF_FRAMES);
+    m_skip_frames = m_backoff;
+    ldout(m_cct, 20) << __func__ << " compression ratio=" << get_ratio()
+		     << " is too low, skipping " << m_skip_frames
+		     << " frames" << dendl;
+    return false;
+  }
+  m_backoff = 0;
+  ++m_stats.frames_compressed;
+  m_stats.bytes_in += m_init_onwire_size;
+  m_stats.bytes_out += m_onwire_size;
+  return true;
+}
+
+std::ostream& operator<<(std::ostream& out, const TxHandler::stats_t& s)
+{
+  return out << "compressed=" << s.frames_compressed
+	     << " incompressible=" << s.frames_incompressible
+	     << " skipped=" << s.frames_skipped
+	     << " bytes_in=" << s.bytes_in
+	     << " bytes_out=" << s.bytes_out;
 }
 
 } // namespace ceph::compression::onwire
@@ -4,6 +4,7 @@
 #ifndef CEPH_COMPRESSION_ONWIRE_H
 #define CEPH_COMPRESSION_ONWIRE_H
 
+#include <iosfwd>
 #include <optional>
 
 #include "compressor/Compressor.h"
@@ -44,20 +45,37 @@ namespace ceph::compression::onwire {
 
   class TxHandler final : private Handler {
   public:
-    TxHandler(CephContext* const cct, CompressorRef compressor, int mode, std::uint64_t min_size)
+    TxHandler(CephContext* const cct, CompressorRef compressor, int mode,
+	      std::uint64_t min_size, double required_ratio)
       : Handler(cct, compressor),
 	m_min_size(min_size),
+	m_required_ratio(required_ratio),
 	m_mode(static_cast<Compressor::CompressionMode>(mode))
     {}
     ~TxHandler() {}
 
+    /// per-connection outcome of compression attempts
+    struct stats_t {
+      uint64_t frames_compressed = 0;
+      uint64_t frames_incompressible = 0; ///< compressed, but sent as is
+      uint64_t frames_skipped = 0;        ///< not tried while backing off
+      uint64_t bytes_in = 0;              ///< of frames sent compressed
+      uint64_t bytes_out = 0;
+    };
+
     void reset_handler(int num_segments, uint64_t size) {
       m_init_onwire_size = size;
       m_compress_potential = size;
       m_onwire_size = 0;
     }
 
-    void done();
+    /**
+     * Completes compression of a frame
+     *
+     * @returns true if the compressed segments should be sent, false if
+     * the frame did not compress well enough and should be sent as is
+     */
+    bool done();
 
     /**
      * Compresses a bufferlist 
@@ -81,15 +99,30 @@ namespace ceph::compression::onwire {
       return m_onwire_size;
     }
 
+    const stats_t& get_stats() const {
+      return m_stats;
+    }
+
   private:
+    // an incompressible frame makes us skip up to this many frames
+    // before sampling again
+    static constexpr uint32_t MAX_BACKOFF_FRAMES = 64;
+
     uint64_t m_min_size; 
+    double m_required_ratio;
     Compressor::CompressionMode m_mode;
 
     uint64_t m_init_onwire_size;
     uint64_t m_onwire_size;
     uint64_t m_compress_potential;
+
+    uint32_t m_backoff = 0;
+    uint32_t m_skip_frames = 0;
+    stats_t m_stats;
   };
 
+  std::ostream& operator<<(std::ostream& out, const TxHandler::stats_t& s);
+
   struct rxtx_t {
     std::unique_ptr<RxHandler> rx;
     std::unique_ptr<TxHandler> tx;
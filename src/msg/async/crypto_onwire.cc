@@ -18,6 +18,8 @@ static constexpr const std::size_t AESGCM_KEY_LEN{16};
 static constexpr const std::size_t AESGCM_IV_LEN{12};
 static constexpr const std::size_t AESGCM_TAG_LEN{16};
 static constexpr const std::size_t AESGCM_BLOCK_LEN{16};
+// plaintext buffers shorter than this are batched into one EVP call
+static constexpr const std::size_t AESGCM_COALESCE_MAX{4096};
 
 struct nonce_t {
   ceph_le32 fixed;
@@ -112,20 +114,51 @@ void AES128GCM_OnWireTxHandler::authenticated_encrypt_update(
               plaintext.length());
   auto filler = buffer.append_hole(plaintext.length());
 
-  for (const auto& plainbuf : plaintext.buffers()) {
+  // Segments are often made of many small buffers (encoded headers,
+  // fronts, the pieces of a fragmented data payload...). EVP calls
+  // have a fixed cost and the AES-NI/PCLMUL code paths only reach full
+  // speed on longer runs, so copy runs of small buffers into the
+  // output and encrypt each run in place with a single call. Larger
+  // buffers are still encrypted straight from the source.
+  char* run_start = filler.c_str();
+  unsigned run_len = 0;
+  auto encrypt = [this](char* out, const char* in, unsigned len) {
     int update_len = 0;
 
     if(1 != EVP_EncryptUpdate(ectx.get(),
-	reinterpret_cast<unsigned char*>(filler.c_str()),
+	reinterpret_cast<unsigned char*>(out),
 	&update_len,
-	reinterpret_cast<const unsigned char*>(plainbuf.c_str()),
-	plainbuf.length())) {
+	reinterpret_cast<const unsigned char*>(in),
+	len)) {
       throw std::runtime_error("EVP_EncryptUpdate failed");
     }
     ceph_assert_always(update_len >= 0);
-    ceph_assert(static_cast<unsigned>(update_len) == plainbuf.length());
-    filler.advance(update_len);
+    ceph_assert(static_cast<unsigned>(update_len) == len);
+  };
+  auto flush_run = [&] {
+    if (run_len > 0) {
+      encrypt(run_start, run_start, run_len);
+      run_len = 0;
+    }
+  };
+
+  for (const auto& plainbuf : plaintext.buffers()) {
+    if (plainbuf.length() < AESGCM_COALESCE_MAX) {
+      if (run_len == 0) {
+	run_start = filler.c_str();
+      }
+      filler.copy_in(plainbuf.length(), plainbuf.c_str());
+      run_len += plainbuf.length();
+      if (run_len >= AESGCM_COALESCE_MAX) {
+	flush_run();
+      }
+    } else {
+      flush_run();
+      encrypt(filler.c_str(), plainbuf.c_str(), plainbuf.length());
+      filler.advance(plainbuf.length());
+    }
   }
+  flush_run();
 
   ldout(cct, 15) << __func__
 		 << " plaintext.length()=" << plaintext.length()
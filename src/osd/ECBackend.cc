@@ -176,6 +176,7 @@ ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
       << " plan.will_write=" << rhs.plan.will_write
+      << " plan.parity_deltas=" << rhs.plan.parity_deltas
       << ")";
   return lhs;
 }
@@ -222,6 +223,7 @@ ECBackend::ECBackend(
     sinfo(ec_impl->get_data_chunk_count(), stripe_width) {
   ceph_assert((ec_impl->get_data_chunk_count() *
 	  ec_impl->get_chunk_size(stripe_width)) == stripe_width);
+  on_config_change();
 }
 
 PGBackend::RecoveryHandle *ECBackend::open_recovery_op()
@@ -1474,6 +1476,7 @@ void ECBackend::on_change()
   for (auto &&op: tid_to_op_map) {
     cache.release_write_pin(op.second.pin);
   }
+  cache.drop_cached();
   tid_to_op_map.clear();
 
   for (map<ceph_tid_t, ReadOp>::iterator i = tid_to_read_map.begin();
@@ -1494,6 +1497,14 @@ void ECBackend::on_change()
   clear_recovery_state();
 }
 
+void ECBackend::on_config_change()
+{
+  // without overwrites there is never an rmw to serve from the cache
+  cache.set_max_cached_bytes(
+    get_parent()->get_pool().allows_ecoverwrites() ?
+    cct->_conf->osd_ec_extent_cache_size : 0);
+}
+
 void ECBackend::clear_recovery_state()
 {
   recovery_ops.clear();
@@ -1881,6 +1892,38 @@ ECUtil::HashInfoRef ECBackend::get_hash_info(
   return ref;
 }
 
+uint64_t ECBackend::get_max_delta_chunks(const hobject_t &hoid)
+{
+  if (!cct->_conf->osd_ec_parity_delta_writes ||
+      !get_parent()->get_pool().allows_ecoverwrites() ||
+      !(ec_impl->get_supported_optimizations() &
+	ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION)) {
+    return 0;
+  }
+  // n modified chunks read n + m chunks instead of k and write n + m
+  // instead of k + m
+  const uint64_t k = ec_impl->get_data_chunk_count();
+  const uint64_t m = ec_impl->get_coding_chunk_count();
+  if (k <= m) {
+    return 0;
+  }
+  // the coding chunks are read from disk, they must not be stale
+  for (auto *ops : {&waiting_state, &waiting_reads, &waiting_commit}) {
+    for (auto &&op : *ops) {
+      if (op.plan.will_write.count(hoid)) {
+	return 0;
+      }
+    }
+  }
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, set<pg_shard_t>(), have, shards, false);
+  if (have.size() != ec_impl->get_chunk_count()) {
+    return 0;
+  }
+  return k - m;
+}
+
 void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
 {
   ceph_assert(op);
@@ -1899,7 +1942,14 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
       }
       return ref;
     },
+    [&](const hobject_t &i) {
+      return get_max_delta_chunks(i);
+    },
     get_parent()->get_dpp());
+  if (!op->plan.parity_deltas.empty()) {
+    get_parent()->get_logger()->inc(
+      l_osd_ec_parity_delta_writes, op->plan.parity_deltas.size());
+  }
 
   dout(10) << __func__ << ": " << *op << dendl;
 
@@ -1949,6 +1999,11 @@ bool ECBackend::try_state_to_reads()
 	op->pin,
 	hpair.second,
 	to_read_plan);
+      get_parent()->get_logger()->inc(
+	l_osd_ec_extent_cache_hit_bytes,
+	to_read_plan.size() - remote_read.size());
+      get_parent()->get_logger()->inc(
+	l_osd_ec_extent_cache_miss_bytes, remote_read.size());
 
       extent_set pending_read = to_read_plan;
       pending_read.subtract(remote_read);
@@ -1977,10 +2032,85 @@ bool ECBackend::try_state_to_reads()
 	check_ops();
       });
   }
+  if (!op->plan.parity_deltas.empty()) {
+    op->delta_read_in_progress = true;
+    objects_read_delta_chunks(
+      op->plan.parity_deltas,
+      make_gen_lambda_context<
+      map<hobject_t,pair<int, map<int, bufferlist>>> &&>(
+	  [this, op](map<hobject_t,pair<int, map<int, bufferlist>>> &&results) {
+	    set<hobject_t> failed;
+	    for (auto &&[hoid, result] : results) {
+	      if (result.first == 0) {
+		op->delta_read_result.emplace(hoid, std::move(result.second));
+	      } else {
+		failed.insert(hoid);
+	      }
+	    }
+	    if (!failed.empty()) {
+	      objects_read_delta_stripes(op, std::move(failed));
+	      return;
+	    }
+	    op->delta_read_in_progress = false;
+	    check_ops();
+	  }));
+  }
 
   return true;
 }
 
+void ECBackend::objects_read_delta_stripes(
+  Op *op,
+  set<hobject_t> &&failed)
+{
+  // fall back to the full stripe read of an rmw, the old content of the
+  // delta chunks is taken from the stripe and its re-encoded coding chunks
+  map<hobject_t,extent_set> to_read;
+  for (auto &&hoid : failed) {
+    const auto &delta = op->plan.parity_deltas.at(hoid);
+    dout(10) << __func__ << ": " << hoid << " " << delta
+	     << " reading the full stripe" << dendl;
+    to_read[hoid].insert(delta.offset, sinfo.get_stripe_width());
+  }
+  objects_read_async_no_cache(
+    to_read,
+    [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+      for (auto &&[hoid, result] : results) {
+	const auto &delta = op->plan.parity_deltas.at(hoid);
+	const uint64_t stripe_width = sinfo.get_stripe_width();
+	int r = result.first;
+	extent_map emap = result.second.intersect(delta.offset, stripe_width);
+	if (r == 0 &&
+	    (emap.ext_count() != 1 ||
+	     emap.begin().get_len() != stripe_width)) {
+	  r = -EIO;
+	}
+	if (r != 0) {
+	  // the stripe cannot be read at all, the op stays blocked until
+	  // the next interval change restarts it
+	  get_parent()->clog_error() << "failed to read " << hoid
+				     << " stripe " << delta.offset << "~"
+				     << stripe_width << " for a write: "
+				     << cpp_strerror(r);
+	  return;
+	}
+	bufferlist stripe = emap.begin().get_val();
+	set<int> want = delta.chunks;
+	for (unsigned i = ec_impl->get_data_chunk_count();
+	     i < ec_impl->get_chunk_count();
+	     ++i) {
+	  want.insert(i);
+	}
+	map<int, bufferlist> chunks;
+	r = ECUtil::encode(sinfo, ec_impl, stripe, want, &chunks);
+	ceph_assert(r == 0);
+	op->delta_read_result.emplace(hoid, std::move(chunks));
+      }
+      op->delta_read_in_progress = false;
+      check_ops();
+    });
+}
+
 bool ECBackend::try_reads_to_commit()
 {
   if (waiting_reads.empty())
@@ -2029,6 +2159,7 @@ bool ECBackend::try_reads_to_commit()
       get_parent()->get_info().pgid.pgid,
       sinfo,
       op->remote_read_result,
+      op->delta_read_result,
       op->log_entries,
       &written,
       &trans,
@@ -2067,6 +2198,7 @@ bool ECBackend::try_reads_to_commit()
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->delta_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -2182,6 +2314,10 @@ bool ECBackend::try_finish_rmw()
   if (op->using_cache) {
     cache.release_write_pin(op->pin);
   }
+  if (!op->using_cache || op->invalidates_cache()) {
+    // objects may have changed behind the cache's back
+    cache.drop_cached();
+  }
   tid_to_op_map.erase(op->tid);
 
   if (waiting_reads.empty() &&
@@ -2223,6 +2359,8 @@ void ECBackend::objects_read_async(
 
   uint32_t flags = 0;
   extent_set es;
+  uint64_t requested = 0;
+  set<int> want_to_read;
   for (list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
 	 pair<bufferlist*, Context*> > >::const_iterator i =
 	 to_read.begin();
@@ -2234,6 +2372,21 @@ void ECBackend::objects_read_async(
 
     es.union_insert(tmp.first, tmp.second);
     flags |= i->first.get<2>();
+    requested += i->first.get<1>();
+    get_want_to_read_shards(i->first.get<0>(), i->first.get<1>(),
+			    &want_to_read);
+  }
+  get_parent()->get_logger()->inc(l_osd_ec_read_requested_bytes, requested);
+
+  // sub-chunked codes (clay) decode with sub-chunk granularity and always
+  // read every data shard
+  map<hobject_t, set<int>> client_want_to_read;
+  if (cct->_conf->osd_ec_partial_reads &&
+      ec_impl->get_sub_chunk_count() == 1 &&
+      want_to_read.size() < ec_impl->get_data_chunk_count()) {
+    dout(20) << __func__ << ": " << hoid << " partial read from shards "
+	     << want_to_read << dendl;
+    client_want_to_read.emplace(hoid, std::move(want_to_read));
   }
 
   if (!es.empty()) {
@@ -2327,7 +2480,8 @@ void ECBackend::objects_read_async(
 	cb(this,
 	   hoid,
 	   to_read,
-	   on_complete)));
+	   on_complete)),
+    &client_want_to_read);
 }
 
 struct CallClientContexts :
@@ -2336,12 +2490,49 @@ struct CallClientContexts :
   ECBackend *ec;
   ECBackend::ClientAsyncReadStatus *status;
   list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+  // data shards to return for a partial read, empty to decode whole stripes
+  set<int> want;
+  bool client_read;
   CallClientContexts(
     hobject_t hoid,
     ECBackend *ec,
     ECBackend::ClientAsyncReadStatus *status,
-    const list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read)
-    : hoid(hoid), ec(ec), status(status), to_read(to_read) {}
+    const list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
+    set<int> &&want,
+    bool client_read)
+    : hoid(hoid), ec(ec), status(status), to_read(to_read),
+      want(std::move(want)), client_read(client_read) {}
+  int decode_partial(
+    uint64_t offset,
+    map<int, bufferlist> &to_decode,
+    extent_map *result) {
+    map<int, bufferlist> decoded;
+    map<int, bufferlist*> out;
+    for (auto shard : want) {
+      out[shard] = &decoded[shard];
+    }
+    int r = ECUtil::decode(ec->sinfo, ec->ec_impl, to_decode, out);
+    if (r < 0)
+      return r;
+    const uint64_t chunk_size = ec->sinfo.get_chunk_size();
+    const uint64_t stripe_width = ec->sinfo.get_stripe_width();
+    const vector<int> &chunk_mapping = ec->ec_impl->get_chunk_mapping();
+    for (int i = 0; i < (int)ec->ec_impl->get_data_chunk_count(); ++i) {
+      int shard = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
+      auto d = decoded.find(shard);
+      if (d == decoded.end())
+	continue;
+      for (uint64_t off = 0; off < d->second.length(); off += chunk_size) {
+	bufferlist chunk;
+	chunk.substr_of(d->second, off, chunk_size);
+	result->insert(
+	  offset + (off / chunk_size) * stripe_width + i * chunk_size,
+	  chunk_size,
+	  std::move(chunk));
+      }
+    }
+    return 0;
+  }
   void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
     ECBackend::read_result_t &res = in.second;
     extent_map result;
@@ -2357,12 +2548,27 @@ struct CallClientContexts :
 	     res.returned.front().get<1>() == adjusted.second);
       map<int, bufferlist> to_decode;
       bufferlist bl;
+      uint64_t shard_bytes = 0;
       for (map<pg_shard_t, bufferlist>::iterator j =
 	     res.returned.front().get<2>().begin();
 	   j != res.returned.front().get<2>().end();
 	   ++j) {
+	shard_bytes += j->second.length();
 	to_decode[j->first.shard] = std::move(j->second);
       }
+      if (client_read) {
+	ec->get_parent()->get_logger()->inc(
+	  l_osd_ec_read_shard_bytes, shard_bytes);
+      }
+      if (!want.empty()) {
+	int r = decode_partial(adjusted.first, to_decode, &result);
+	if (r < 0) {
+	  res.r = r;
+	  goto out;
+	}
+	res.returned.pop_front();
+	continue;
+      }
       int r = ECUtil::decode(
 	ec->sinfo,
 	ec->ec_impl,
@@ -2393,7 +2599,8 @@ void ECBackend::objects_read_and_reconstruct(
     std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
   > &reads,
   bool fast_read,
-  GenContextURef<map<hobject_t,pair<int, extent_map> > &&> &&func)
+  GenContextURef<map<hobject_t,pair<int, extent_map> > &&> &&func,
+  const map<hobject_t, set<int>> *client_want_to_read)
 {
   in_progress_client_reads.emplace_back(
     reads.size(), std::move(func));
@@ -2408,20 +2615,35 @@ void ECBackend::objects_read_and_reconstruct(
     
   map<hobject_t, read_request_t> for_read_op;
   for (auto &&to_read: reads) {
+    set<int> partial_want_to_read;
+    if (client_want_to_read) {
+      auto p = client_want_to_read->find(to_read.first);
+      if (p != client_want_to_read->end()) {
+	partial_want_to_read = p->second;
+      }
+    }
+    if (!partial_want_to_read.empty()) {
+      get_parent()->get_logger()->inc(l_osd_ec_read_partial);
+    }
+    const set<int> &want = partial_want_to_read.empty() ?
+      want_to_read : partial_want_to_read;
     map<pg_shard_t, vector<pair<int, int>>> shards;
     int r = get_min_avail_to_read_shards(
       to_read.first,
-      want_to_read,
+      want,
       false,
       fast_read,
       &shards);
     ceph_assert(r == 0);
 
+    obj_want_to_read.insert(make_pair(to_read.first, want));
     CallClientContexts *c = new CallClientContexts(
       to_read.first,
       this,
       &(in_progress_client_reads.back()),
-      to_read.second);
+      to_read.second,
+      std::move(partial_want_to_read),
+      client_want_to_read != nullptr);
     for_read_op.insert(
       make_pair(
 	to_read.first,
@@ -2430,7 +2652,6 @@ void ECBackend::objects_read_and_reconstruct(
 	  shards,
 	  false,
 	  c)));
-    obj_want_to_read.insert(make_pair(to_read.first, want_to_read));
   }
 
   start_read_op(
@@ -2443,6 +2664,110 @@ void ECBackend::objects_read_and_reconstruct(
 }
 
 
+struct CallDeltaReadContexts :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  struct Status {
+    size_t remaining;
+    map<hobject_t,pair<int, map<int, bufferlist>>> results;
+    GenContextURef<map<hobject_t,pair<int, map<int, bufferlist>>> &&> func;
+  };
+  hobject_t hoid;
+  ECBackend *ec;
+  set<int> want;
+  std::shared_ptr<Status> status;
+  CallDeltaReadContexts(
+    const hobject_t &hoid,
+    ECBackend *ec,
+    const set<int> &want,
+    std::shared_ptr<Status> status)
+    : hoid(hoid), ec(ec), want(want), status(std::move(status)) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ECBackend::read_result_t &res = in.second;
+    auto &[r, chunks] = status->results[hoid];
+    r = res.r;
+    if (r == 0) {
+      ceph_assert(res.returned.size() == 1);
+      map<int, bufferlist> to_decode;
+      for (auto &&[shard, bl] : res.returned.front().get<2>()) {
+	to_decode[shard.shard] = std::move(bl);
+      }
+      map<int, bufferlist*> out;
+      for (auto shard : want) {
+	out[shard] = &chunks[shard];
+      }
+      r = ECUtil::decode(ec->sinfo, ec->ec_impl, to_decode, out);
+    }
+    if (r != 0) {
+      ldpp_dout(ec->get_parent()->get_dpp(), 1)
+	<< __func__ << ": " << hoid << " failed to read chunks " << want
+	<< ": " << cpp_strerror(r) << dendl;
+      chunks.clear();
+    }
+    if (--status->remaining == 0) {
+      status->func.release()->complete(std::move(status->results));
+    }
+  }
+};
+
+void ECBackend::objects_read_delta_chunks(
+  const map<hobject_t,ECTransaction::ParityDelta> &deltas,
+  GenContextURef<map<hobject_t,pair<int, map<int, bufferlist>>> &&> &&func)
+{
+  ceph_assert(!deltas.empty());
+  auto status = std::make_shared<CallDeltaReadContexts::Status>();
+  status->func = std::move(func);
+
+  map<hobject_t, set<int>> obj_want_to_read;
+  map<hobject_t, read_request_t> for_read_op;
+  for (auto &&[hoid, delta] : deltas) {
+    // plugins supporting parity deltas do not remap chunks
+    set<int> want = delta.chunks;
+    for (unsigned i = ec_impl->get_data_chunk_count();
+	 i < ec_impl->get_chunk_count();
+	 ++i) {
+      want.insert(i);
+    }
+    map<pg_shard_t, vector<pair<int, int>>> shards;
+    int r = get_min_avail_to_read_shards(
+      hoid,
+      want,
+      false,
+      false,
+      &shards);
+    if (r != 0) {
+      // a shard went away since the write was planned
+      dout(1) << __func__ << ": " << hoid << " " << delta
+	      << " cannot read chunks " << want << dendl;
+      status->results[hoid].first = r;
+      continue;
+    }
+
+    dout(20) << __func__ << ": " << hoid << " " << delta
+	     << " reading " << shards << dendl;
+    obj_want_to_read.insert(make_pair(hoid, want));
+    for_read_op.insert(
+      make_pair(
+	hoid,
+	read_request_t(
+	  {boost::make_tuple(delta.offset, sinfo.get_stripe_width(), 0u)},
+	  shards,
+	  false,
+	  new CallDeltaReadContexts(hoid, this, want, status))));
+  }
+
+  status->remaining = for_read_op.size();
+  if (for_read_op.empty()) {
+    status->func.release()->complete(std::move(status->results));
+    return;
+  }
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    obj_want_to_read,
+    for_read_op,
+    OpRequestRef(),
+    false, false);
+}
+
 int ECBackend::send_all_remaining_reads(
   const hobject_t &hoid,
   ReadOp &rop)
@@ -90,6 +90,7 @@ public:
   void check_recovery_sources(const OSDMapRef& osdmap) override;
 
   void on_change() override;
+  void on_config_change() override;
   void clear_recovery_state() override;
 
   void dump_recovery_info(ceph::Formatter *f) const override;
@@ -135,14 +136,22 @@ public:
    * still only perform a client read from shards in the acting std::set.  This
    * ensures that we won't ever have to restart a client initiated read in
    * check_recovery_sources.
+   *
+   * For client reads, client_want_to_read gives the data shards holding
+   * the bytes actually requested from each object.  When that is a
+   * strict subset of the data shards only those are read (or, if some
+   * of them are unavailable, just enough shards to rebuild them) and
+   * only their chunks are returned, instead of decoding whole stripes.
    */
   void objects_read_and_reconstruct(
     const std::map<hobject_t, std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
     > &reads,
     bool fast_read,
-    GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func);
+    GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func,
+    const std::map<hobject_t, std::set<int>> *client_want_to_read = nullptr);
 
   friend struct CallClientContexts;
+  friend struct CallDeltaReadContexts;
   struct ClientAsyncReadStatus {
     unsigned objects_to_read;
     GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> func;
@@ -216,6 +225,15 @@ private:
     }
   }
 
+  /// data shards holding the logical range [offset, offset + length)
+  void get_want_to_read_shards(
+    uint64_t offset,
+    uint64_t length,
+    std::set<int> *want_to_read) const {
+    sinfo.offset_len_to_data_shards(
+      offset, length, ec_impl->get_chunk_mapping(), want_to_read);
+  }
+
   /**
    * Recovery
    *
@@ -471,7 +489,9 @@ public:
     std::set<hobject_t> temp_cleared;
 
     ECTransaction::WritePlan plan;
-    bool requires_rmw() const { return !plan.to_read.empty(); }
+    bool requires_rmw() const {
+      return !plan.to_read.empty() || !plan.parity_deltas.empty();
+    }
     bool invalidates_cache() const { return plan.invalidates_cache; }
 
     // must be true if requires_rmw(), must be false if invalidates_cache()
@@ -481,8 +501,12 @@ public:
     std::map<hobject_t,extent_set> pending_read; // subset already being read
     std::map<hobject_t,extent_set> remote_read;  // subset we must read
     std::map<hobject_t,extent_map> remote_read_result;
+    /// previous content of the chunks touched by plan.parity_deltas
+    std::map<hobject_t,std::map<int, ceph::buffer::list>> delta_read_result;
+    bool delta_read_in_progress = false;
     bool read_in_progress() const {
-      return !remote_read.empty() && remote_read_result.empty();
+      return (!remote_read.empty() && remote_read_result.empty()) ||
+	delta_read_in_progress;
     }
 
     /// In progress write state.
@@ -560,6 +584,13 @@ public:
   op_list waiting_commit;       /// writes waiting on initial commit
   eversion_t completed_to;
   eversion_t committed_to;
+  uint64_t get_max_delta_chunks(const hobject_t &hoid);
+  void objects_read_delta_chunks(
+    const std::map<hobject_t,ECTransaction::ParityDelta> &deltas,
+    GenContextURef<
+      std::map<hobject_t,
+	       std::pair<int, std::map<int, ceph::buffer::list>>> &&> &&func);
+  void objects_read_delta_stripes(Op *op, std::set<hobject_t> &&failed);
   void start_rmw(Op *op, PGTransactionUPtr &&t);
   bool try_state_to_reads();
   bool try_reads_to_commit();
@@ -30,6 +30,7 @@ using std::string;
 using std::vector;
 
 using ceph::bufferlist;
+using ceph::bufferptr;
 using ceph::decode;
 using ceph::encode;
 using ceph::ErasureCodeInterfaceRef;
@@ -93,6 +94,107 @@ void encode_and_write(
   }
 }
 
+void write_parity_delta(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const ECTransaction::ParityDelta &delta,
+  const PGTransaction::ObjectOperation &op,
+  const map<int, bufferlist> &old_chunks,
+  extent_map &written,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const unsigned data_chunk_count = ecimpl->get_data_chunk_count();
+  const uint64_t offset =
+    delta.offset + *delta.chunks.begin() * chunk_size;
+  const uint64_t length = delta.chunks.size() * chunk_size;
+
+  auto get_chunk = [&](int chunk) {
+    auto p = old_chunks.find(chunk);
+    ceph_assert(p != old_chunks.end());
+    ceph_assert(p->second.length() == chunk_size);
+    // copied: the coding chunks are updated in place
+    bufferptr ptr = ceph::buffer::create(chunk_size);
+    p->second.begin().copy(chunk_size, ptr.c_str());
+    return ptr;
+  };
+
+  // the previous content of the modified chunks with the new buffers on top
+  extent_map updated;
+  bufferlist old_data;
+  for (auto chunk : delta.chunks) {
+    old_data.append(get_chunk(chunk));
+  }
+  updated.insert(offset, length, old_data);
+
+  uint32_t fadvise_flags = 0;
+  for (auto &&extent: op.buffer_updates) {
+    using BufferUpdate = PGTransaction::ObjectOperation::BufferUpdate;
+    bufferlist bl;
+    match(
+      extent.get_val(),
+      [&](const BufferUpdate::Write &op) {
+	bl = op.buffer;
+	fadvise_flags |= op.fadvise_flags;
+      },
+      [&](const BufferUpdate::Zero &) {
+	bl.append_zero(extent.get_len());
+      },
+      [&](const BufferUpdate::CloneRange &) {
+	ceph_assert(
+	  0 ==
+	  "CloneRange is not allowed, do_op should have returned ENOTSUPP");
+      });
+    updated.insert(extent.get_off(), extent.get_len(), bl);
+  }
+  ceph_assert(updated.ext_count() == 1);
+  bufferlist new_data = updated.begin().get_val();
+  ceph_assert(new_data.length() == length);
+
+  map<int, bufferptr> deltas;
+  map<int, bufferlist> buffers;
+  uint64_t pos = 0;
+  for (auto chunk : delta.chunks) {
+    bufferlist &bl = buffers[chunk];
+    bl.substr_of(new_data, pos, chunk_size);
+    pos += chunk_size;
+    ecimpl->encode_delta(
+      get_chunk(chunk),
+      bufferptr(bl.c_str(), chunk_size),
+      &deltas[chunk]);
+  }
+  map<int, bufferptr> parity;
+  for (unsigned i = data_chunk_count; i < ecimpl->get_chunk_count(); ++i) {
+    parity[i] = get_chunk(i);
+  }
+  int r = ecimpl->apply_delta(deltas, parity);
+  ceph_assert(r == 0);
+  for (auto &&[chunk, ptr] : parity) {
+    buffers[chunk].append(std::move(ptr));
+  }
+
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " " << delta
+		     << " writing " << offset << "~" << length
+		     << dendl;
+  written.insert(offset, length, new_data);
+
+  for (auto &&[chunk, bl] : buffers) {
+    auto t = transactions->find(shard_id_t(chunk));
+    if (t == transactions->end())
+      continue;
+    t->second.write(
+      coll_t(spg_t(pgid, t->first)),
+      ghobject_t(oid, ghobject_t::NO_GEN, t->first),
+      sinfo.aligned_logical_offset_to_chunk_offset(delta.offset),
+      bl.length(),
+      bl,
+      fadvise_flags);
+  }
+}
+
 bool ECTransaction::requires_overwrite(
   uint64_t prev_size,
   const PGTransaction::ObjectOperation &op) {
@@ -106,12 +208,56 @@ bool ECTransaction::requires_overwrite(
       (op.truncate->first < prev_size)));
 }
 
+std::ostream &ECTransaction::operator<<(
+  std::ostream &lhs,
+  const ParityDelta &rhs)
+{
+  return lhs << "ParityDelta(" << rhs.offset << " chunks=" << rhs.chunks
+	     << ")";
+}
+
+std::optional<ECTransaction::ParityDelta> ECTransaction::get_parity_delta(
+  const ECUtil::stripe_info_t &sinfo,
+  const PGTransaction::ObjectOperation &op,
+  const extent_set &raw_write_set,
+  uint64_t projected_size,
+  uint64_t max_chunks)
+{
+  if (max_chunks == 0 ||
+      !op.is_none() ||
+      op.truncate ||
+      raw_write_set.num_intervals() != 1) {
+    return std::nullopt;
+  }
+  const uint64_t start = raw_write_set.range_start();
+  const uint64_t end = raw_write_set.range_end();
+  const uint64_t stripe = sinfo.logical_to_prev_stripe_offset(start);
+  if (end > stripe + sinfo.get_stripe_width() ||
+      stripe + sinfo.get_stripe_width() > projected_size) {
+    return std::nullopt;
+  }
+  const uint64_t first = (start - stripe) / sinfo.get_chunk_size();
+  const uint64_t last = (end - 1 - stripe) / sinfo.get_chunk_size();
+  if (last - first + 1 > max_chunks ||
+      (last - first + 1) * sinfo.get_chunk_size() >=
+	sinfo.get_stripe_width()) {
+    return std::nullopt;
+  }
+  ParityDelta delta;
+  delta.offset = stripe;
+  for (uint64_t c = first; c <= last; ++c) {
+    delta.chunks.insert(c);
+  }
+  return delta;
+}
+
 void ECTransaction::generate_transactions(
   WritePlan &plan,
   ErasureCodeInterfaceRef &ecimpl,
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,map<int, bufferlist>> &delta_chunks,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -403,6 +549,62 @@ void ECTransaction::generate_transactions(
 	}
       }
 
+      if (auto diter = plan.parity_deltas.find(oid);
+	  diter != plan.parity_deltas.end()) {
+	const auto &delta = diter->second;
+	auto citer = delta_chunks.find(oid);
+	ceph_assert(citer != delta_chunks.end());
+	ceph_assert(!op.truncate);
+	if (entry) {
+	  uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
+	    delta.offset);
+	  uint64_t restore_len = sinfo.get_chunk_size();
+	  ldpp_dout(dpp, 20) << __func__ << ": overwriting "
+			     << restore_from << "~" << restore_len
+			     << dendl;
+	  // every shard rolls back the same extents, including those we
+	  // leave untouched
+	  for (auto &&st : *transactions) {
+	    st.second.touch(
+	      coll_t(spg_t(pgid, st.first)),
+	      ghobject_t(oid, entry->version.version, st.first));
+	    st.second.clone_range(
+	      coll_t(spg_t(pgid, st.first)),
+	      ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	      ghobject_t(oid, entry->version.version, st.first),
+	      restore_from,
+	      restore_len,
+	      restore_from);
+	  }
+	  entry->mod_desc.rollback_extents(
+	    entry->version.version,
+	    {make_pair(restore_from, restore_len)});
+	}
+	write_parity_delta(
+	  pgid,
+	  oid,
+	  sinfo,
+	  ecimpl,
+	  delta,
+	  op,
+	  citer->second,
+	  written,
+	  transactions,
+	  dpp);
+	hinfo->set_total_chunk_size_clear_hash(
+	  hinfo->get_total_chunk_size());
+	bufferlist hbuf;
+	encode(*hinfo, hbuf);
+	for (auto &&i : *transactions) {
+	  i.second.setattr(
+	    coll_t(spg_t(pgid, i.first)),
+	    ghobject_t(oid, ghobject_t::NO_GEN, i.first),
+	    ECUtil::get_hinfo_key(),
+	    hbuf);
+	}
+	return;
+      }
+
       extent_map to_write;
       auto pextiter = partial_extents.find(oid);
       if (pextiter != partial_extents.end()) {
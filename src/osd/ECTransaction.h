@@ -23,11 +23,23 @@
 #include "ExtentCache.h"
 
 namespace ECTransaction {
+  /**
+   * A partial stripe overwrite applied to the coding chunks as a delta:
+   * only the old content of the modified data chunks and of the coding
+   * chunks is read, and only those chunks are written.
+   */
+  struct ParityDelta {
+    uint64_t offset = 0;    // logical offset of the stripe
+    std::set<int> chunks;   // modified data chunks, 0 to k - 1
+  };
+  std::ostream &operator<<(std::ostream &lhs, const ParityDelta &rhs);
+
   struct WritePlan {
     PGTransactionUPtr t;
     bool invalidates_cache = false; // Yes, both are possible
     std::map<hobject_t,extent_set> to_read;
     std::map<hobject_t,extent_set> will_write; // superset of to_read
+    std::map<hobject_t,ParityDelta> parity_deltas; // not in to_read
 
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
   };
@@ -36,12 +48,38 @@ namespace ECTransaction {
     uint64_t prev_size,
     const PGTransaction::ObjectOperation &op);
 
+  /// Return the parity delta for op if it overwrites at most max_chunks
+  /// data chunks of a single existing stripe
+  std::optional<ParityDelta> get_parity_delta(
+    const ECUtil::stripe_info_t &sinfo,
+    const PGTransaction::ObjectOperation &op,
+    const extent_set &raw_write_set,
+    uint64_t projected_size,
+    uint64_t max_chunks);
+
   template <typename F>
   WritePlan get_write_plan(
     const ECUtil::stripe_info_t &sinfo,
     PGTransactionUPtr &&t,
     F &&get_hinfo,
     DoutPrefixProvider *dpp) {
+    return get_write_plan(
+      sinfo,
+      std::move(t),
+      std::forward<F>(get_hinfo),
+      [](const hobject_t &) -> uint64_t { return 0; },
+      dpp);
+  }
+
+  /// get_max_delta_chunks(oid) bounds the number of data chunks a parity
+  /// delta write to oid may modify, 0 disables them
+  template <typename F, typename G>
+  WritePlan get_write_plan(
+    const ECUtil::stripe_info_t &sinfo,
+    PGTransactionUPtr &&t,
+    F &&get_hinfo,
+    G &&get_max_delta_chunks,
+    DoutPrefixProvider *dpp) {
     WritePlan plan;
     t->safe_create_traverse(
       [&](std::pair<const hobject_t, PGTransaction::ObjectOperation> &i) {
@@ -96,6 +134,19 @@ namespace ECTransaction {
 	  raw_write_set.insert(extent.get_off(), extent.get_len());
 	}
 
+	auto delta = get_parity_delta(
+	  sinfo, i.second, raw_write_set, projected_size,
+	  get_max_delta_chunks(i.first));
+	if (delta) {
+	  ldpp_dout(dpp, 20) << __func__ << ": parity delta write "
+			     << *delta << dendl;
+	  will_write.union_insert(
+	    delta->offset + *delta->chunks.begin() * sinfo.get_chunk_size(),
+	    delta->chunks.size() * sinfo.get_chunk_size());
+	  plan.parity_deltas.emplace(i.first, std::move(*delta));
+	  return;
+	}
+
 	auto orig_size = projected_size;
 	for (auto extent = raw_write_set.begin();
 	     extent != raw_write_set.end();
@@ -188,6 +239,7 @@ namespace ECTransaction {
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const std::map<hobject_t,extent_map> &partial_extents,
+    const std::map<hobject_t,std::map<int, ceph::buffer::list>> &delta_chunks,
     std::vector<pg_log_entry_t> &entries,
     std::map<hobject_t,extent_map> *written,
     std::map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -31,6 +31,30 @@ int ECUtil::decode(
   if (total_data_size == 0)
     return 0;
 
+  if (ec_impl->get_supported_optimizations() &
+      ErasureCodeInterface::FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION) {
+    // decode all the stripes at once and interleave the data chunks
+    unsigned stripe_count = total_data_size / sinfo.get_chunk_size();
+    unsigned k = ec_impl->get_data_chunk_count();
+    const vector<int> &mapping = ec_impl->get_chunk_mapping();
+    set<int> want;
+    for (unsigned i = 0; i < k; i++)
+      want.insert(mapping.empty() ? i : mapping[i]);
+    map<int, bufferlist> decoded;
+    int r = ec_impl->decode_stripes(stripe_count, want, to_decode, &decoded);
+    ceph_assert(r == 0);
+    for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
+      for (unsigned j = 0; j < k; j++) {
+	bufferlist &chunk = decoded[mapping.empty() ? j : mapping[j]];
+	ceph_assert(chunk.length() == total_data_size);
+	bufferlist bl;
+	bl.substr_of(chunk, i, sinfo.get_chunk_size());
+	out->claim_append(bl);
+      }
+    }
+    return 0;
+  }
+
   for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
     map<int, bufferlist> chunks;
     for (map<int, bufferlist>::iterator j = to_decode.begin();
@@ -96,6 +120,19 @@ int ECUtil::decode(
     }
   }
 
+  if (ec_impl->get_sub_chunk_count() == 1 && chunks_count > 0) {
+    map<int, bufferlist> out_bls;
+    r = ec_impl->decode_stripes(chunks_count, need, to_decode, &out_bls);
+    ceph_assert(r == 0);
+    for (auto &&i : out) {
+      ceph_assert(out_bls.count(i.first));
+      ceph_assert(out_bls[i.first].length() ==
+		  chunks_count * sinfo.get_chunk_size());
+      i.second->claim_append(out_bls[i.first]);
+    }
+    return 0;
+  }
+
   for (int i = 0; i < chunks_count; i++) {
     map<int, bufferlist> chunks;
     for (auto j = to_decode.begin();
@@ -136,19 +173,9 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    ceph_assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      ceph_assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
-    }
-  }
+  int r = ec_impl->encode_stripes(logical_size / sinfo.get_stripe_width(),
+				  want, in, out);
+  ceph_assert(r == 0);
 
   for (map<int, bufferlist>::iterator i = out->begin();
        i != out->end();
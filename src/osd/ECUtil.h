@@ -77,6 +77,24 @@ public:
       (in.first - off) + in.second);
     return std::make_pair(off, len);
   }
+  /// data shards holding the logical range [offset, offset + length)
+  void offset_len_to_data_shards(
+    uint64_t offset,
+    uint64_t length,
+    const std::vector<int> &chunk_mapping,
+    std::set<int> *shards) const {
+    if (length == 0)
+      return;
+    const uint64_t data_chunk_count = stripe_width / chunk_size;
+    const uint64_t first = offset / chunk_size;
+    const uint64_t last = length >= stripe_width ?
+      first + data_chunk_count - 1 :
+      (offset + length - 1) / chunk_size;
+    for (uint64_t c = first; c <= last; ++c) {
+      int i = c % data_chunk_count;
+      shards->insert((int)chunk_mapping.size() > i ? chunk_mapping[i] : i);
+    }
+  }
 };
 
 int decode(
@@ -24,6 +24,7 @@ void ExtentCache::extent::_link_pin_state(pin_state &pin_state)
   ceph_assert(!parent_pin_state);
   parent_pin_state = &pin_state;
   pin_state.pin_list.push_back(*this);
+  pin_state.length += length;
 }
 
 void ExtentCache::extent::_unlink_pin_state()
@@ -32,6 +33,7 @@ void ExtentCache::extent::_unlink_pin_state()
   ceph_assert(parent_pin_state);
   auto liter = pin_state::list::s_iterator_to(*this);
   parent_pin_state->pin_list.erase(liter);
+  parent_pin_state->length -= length;
   parent_pin_state = nullptr;
 }
 
@@ -85,6 +87,16 @@ void ExtentCache::remove_and_destroy_if_empty(object_extent_set &eset)
   }
 }
 
+void ExtentCache::trim_cached(uint64_t target)
+{
+  while (cached.length > target) {
+    std::unique_ptr<extent> extent(&cached.pin_list.front());
+    auto &eset = *(extent->parent_extent_set);
+    extent->unlink();
+    remove_and_destroy_if_empty(eset);
+  }
+}
+
 ExtentCache::object_extent_set &ExtentCache::get_or_create(
   const hobject_t &oid)
 {
@@ -222,7 +234,8 @@ void ExtentCache::present_rmw_update(
 
 ostream &ExtentCache::print(ostream &out) const
 {
-  out << "ExtentCache(" << std::endl;
+  out << "ExtentCache(cached=" << cached.length
+      << "/" << max_cached_bytes << std::endl;
   for (auto esiter = per_object_caches.begin();
        esiter != per_object_caches.end();
        ++esiter) {
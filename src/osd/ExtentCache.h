@@ -25,6 +25,7 @@
 #include "include/interval_set.h"
 #include "common/interval_map.h"
 #include "include/buffer.h"
+#include "include/mempool.h"
 #include "common/hobject.h"
 
 /**
@@ -92,6 +93,21 @@
    All of the above suggests that there are 3 things users can
    ask of the cache corresponding to the 3 Write pipelines
    states.
+
+   Optionally, extents holding data are not dropped when their last
+   write pin is released but handed to an internal pin, cached, which
+   keeps them in LRU order up to set_max_cached_bytes() bytes, accounted
+   in the osd mempool:
+
+   3) Cached:
+      - This extent has the data of the last write to it, which has
+        completed
+      - reserve_extents_for_rmw treats it like a Write Pinned extent and
+        moves it to the new pin, so the rmw does not need to read it
+
+   Since the cache only learns about writes through the rmw pipeline, the
+   user must call drop_cached() whenever objects may have changed without
+   going through it.
  */
 
 /// If someone wants these types, but not ExtentCache, move to another file
@@ -350,10 +366,12 @@ private:
     enum pin_type_t {
       NONE,
       WRITE,
+      CACHED,
     };
     pin_type_t pin_type = NONE;
     bool is_write() const { return pin_type == WRITE; }
 
+    uint64_t length = 0; ///< total length of the extents in pin_list
     pin_state(const pin_state &other) = delete;
     pin_state &operator=(const pin_state &other) = delete;
     pin_state(pin_state &&other) = delete;
@@ -378,20 +396,45 @@ private:
     }
   };
 
+  /// completed writes, least recently used first
+  pin_state cached;
+  uint64_t max_cached_bytes = 0;
+
   void release_pin(pin_state &p) {
     for (auto iter = p.pin_list.begin(); iter != p.pin_list.end(); ) {
-      std::unique_ptr<extent> extent(&*iter); // we now own this
-      iter++; // unlink will invalidate
+      extent *ext = &*iter;
+      iter++; // unlink and move will invalidate
+      if (&p != &cached && max_cached_bytes && !ext->is_pending()) {
+	// the cache may hold on to it for long, make it show up in the
+	// osd mempool instead of wherever its buffers came from
+	ext->bl->reassign_to_mempool(mempool::mempool_osd);
+	ext->move(cached);
+	continue;
+      }
+      std::unique_ptr<extent> extent(ext); // we now own this
       ceph_assert(extent->parent_extent_set);
       auto &eset = *(extent->parent_extent_set);
       extent->unlink();
       remove_and_destroy_if_empty(eset);
     }
-    p.tid = 0;
-    p.pin_type = pin_state::NONE;
+    if (&p != &cached) {
+      p.tid = 0;
+      p.pin_type = pin_state::NONE;
+      trim_cached(max_cached_bytes);
+    }
   }
 
+  void trim_cached(uint64_t target);
+
 public:
+  ExtentCache() {
+    cached.pin_type = pin_state::CACHED;
+  }
+  ~ExtentCache() {
+    release_pin(cached);
+    cached.pin_type = pin_state::NONE;
+  }
+
   class write_pin : private pin_state {
     friend class ExtentCache;
   private:
@@ -481,6 +524,21 @@ public:
     release_pin(pin);
   }
 
+  /// Bound the data kept after writes complete, 0 disables caching
+  void set_max_cached_bytes(uint64_t max) {
+    max_cached_bytes = max;
+    trim_cached(max_cached_bytes);
+  }
+
+  /// Forget all data not pinned by an in progress write
+  void drop_cached() {
+    release_pin(cached);
+  }
+
+  uint64_t get_cached_bytes() const {
+    return cached.length;
+  }
+
   std::ostream &print(std::ostream &out) const;
 };
 
@@ -1338,45 +1338,32 @@ MOSDMap *OSDService::build_incremental_map_msg(epoch_t since, epoch_t to,
   m->oldest_map = max_oldest_map;
   m->newest_map = sblock.newest_map;
 
-  int max = cct->_conf->osd_map_message_max;
-  ssize_t max_bytes = cct->_conf->osd_map_message_max_bytes;
-
   if (since < m->oldest_map) {
     // we don't have the next map the target wants, so start with a
     // full map.
-    bufferlist bl;
     dout(10) << __func__ << " oldest map " << max_oldest_map << " > since "
 	     << since << ", starting with full map" << dendl;
-    since = m->oldest_map;
-    if (!get_map_bl(since, bl)) {
-      derr << __func__ << " missing full map " << since << dendl;
-      goto panic;
-    }
-    max--;
-    max_bytes -= bl.length();
-    m->maps[since] = std::move(bl);
   }
-  for (epoch_t e = since + 1; e <= to; ++e) {
-    bufferlist bl;
-    if (get_inc_map_bl(e, bl)) {
-      m->incremental_maps[e] = std::move(bl);
-    } else {
-      dout(10) << __func__ << " missing incremental map " << e << dendl;
-      if (!get_map_bl(e, bl)) {
-	derr << __func__ << " also missing full map " << e << dendl;
-	goto panic;
+  epoch_t missing = add_maps_to_msg(
+    m, since, to,
+    cct->_conf->osd_map_message_max,
+    cct->_conf->osd_map_message_max_bytes,
+    [this](epoch_t e, bufferlist &bl) {
+      if (get_inc_map_bl(e, bl)) {
+	return true;
       }
-      m->maps[e] = std::move(bl);
-    }
-    max--;
-    max_bytes -= bl.length();
-    if (max <= 0 || max_bytes <= 0) {
-      break;
-    }
+      dout(10) << "build_incremental_map_msg missing incremental map " << e
+	       << dendl;
+      return false;
+    },
+    [this](epoch_t e, bufferlist &bl) {
+      return get_map_bl(e, bl);
+    });
+  if (!missing) {
+    return m;
   }
-  return m;
+  derr << __func__ << " missing full map " << missing << dendl;
 
- panic:
   if (!m->maps.empty() ||
       !m->incremental_maps.empty()) {
     // send what we have so far
@@ -1398,6 +1385,41 @@ MOSDMap *OSDService::build_incremental_map_msg(epoch_t since, epoch_t to,
   return m;
 }
 
+epoch_t OSDService::add_maps_to_msg(
+  MOSDMap *m, epoch_t since, epoch_t to, int max, ssize_t max_bytes,
+  const std::function<bool(epoch_t, bufferlist&)> &get_inc_bl,
+  const std::function<bool(epoch_t, bufferlist&)> &get_full_bl)
+{
+  if (since < m->oldest_map) {
+    bufferlist bl;
+    since = m->oldest_map;
+    if (!get_full_bl(since, bl)) {
+      return since;
+    }
+    max--;
+    max_bytes -= bl.length();
+    m->maps[since] = std::move(bl);
+  }
+  for (epoch_t e = since + 1; e <= to; ++e) {
+    bufferlist bl;
+    if (get_inc_bl(e, bl)) {
+      max_bytes -= bl.length();
+      m->incremental_maps[e] = std::move(bl);
+    } else {
+      if (!get_full_bl(e, bl)) {
+	return e;
+      }
+      max_bytes -= bl.length();
+      m->maps[e] = std::move(bl);
+    }
+    max--;
+    if (max <= 0 || max_bytes <= 0) {
+      break;
+    }
+  }
+  return 0;
+}
+
 void OSDService::send_map(MOSDMap *m, Connection *con)
 {
   con->send_message(m);
@@ -2399,7 +2421,11 @@ int OSD::set_numa_affinity()
 	      << " cpus "
 	      << cpu_set_to_str_list(numa_cpu_set_size, &numa_cpu_set)
 	      << dendl;
-      r = set_cpu_affinity_all_threads(numa_cpu_set_size, &numa_cpu_set);
+      // leave the msgr workers where ms_async_affinity_cores pinned them
+      r = set_cpu_affinity_all_threads(
+	numa_cpu_set_size, &numa_cpu_set,
+	cct->_conf.get_val<std::string>("ms_async_affinity_cores").empty() ?
+	nullptr : "msgr-worker-");
       if (r < 0) {
 	r = -errno;
 	derr << __func__ << " failed to set numa affinity: " << cpp_strerror(r)
@@ -9616,6 +9642,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_object_clean_region_max_num_intervals",
     "osd_scrub_min_interval",
     "osd_scrub_max_interval",
+    "osd_ec_extent_cache_size",
     NULL
   };
   return KEYS;
@@ -9732,6 +9759,15 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     resched_all_scrubs();
     dout(0) << __func__ << ": scrub interval change" << dendl;
   }
+  if (changed.count("osd_ec_extent_cache_size")) {
+    vector<PGRef> pgs;
+    _get_pgs(&pgs);
+    for (auto& pg : pgs) {
+      pg->lock();
+      pg->on_backend_config_change();
+      pg->unlock();
+    }
+  }
   check_config();
   if (changed.count("osd_asio_thread_count")) {
     service.poolctx.stop();
@@ -41,6 +41,7 @@
 #include "osd/scheduler/OpScheduler.h"
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -245,6 +246,18 @@ public:
 			    const OSDMapRef& osdmap);
   MOSDMap *build_incremental_map_msg(epoch_t from, epoch_t to,
                                        OSDSuperblock& superblock);
+  /**
+   * Add the maps after since, up to to, to m: a full map first if since is
+   * older than m->oldest_map, then the incrementals, or the full map of an
+   * epoch whose incremental is missing.  Stops after max maps or once
+   * max_bytes are in.
+   *
+   * @returns 0, or the first epoch neither map could be loaded for
+   */
+  static epoch_t add_maps_to_msg(
+    MOSDMap *m, epoch_t since, epoch_t to, int max, ssize_t max_bytes,
+    const std::function<bool(epoch_t, ceph::buffer::list&)> &get_inc_bl,
+    const std::function<bool(epoch_t, ceph::buffer::list&)> &get_full_bl);
 
   ConnectionRef get_con_osd_cluster(int peer, epoch_t from_epoch);
   std::pair<ConnectionRef,ConnectionRef> get_con_osd_hb(int peer, epoch_t from_epoch);  // (back, front)
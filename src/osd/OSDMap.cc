@@ -1516,7 +1516,8 @@ void OSDMap::set_max_osd(int m)
   osd_addrs->hb_front_addrs.resize(max_osd);
   osd_uuid->resize(max_osd);
   if (osd_primary_affinity)
-    osd_primary_affinity->resize(max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
+    _unshare(osd_primary_affinity).resize(max_osd,
+					  CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
 
   calc_num_osds();
 }
@@ -1709,7 +1710,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
   }
   mask |= CEPH_FEATURES_CRUSH;
 
-  if (!pg_upmap.empty() || !pg_upmap_items.empty())
+  if (!pg_upmap->empty() || !pg_upmap_items->empty())
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
 
@@ -1875,12 +1876,23 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
     n->osd_addrs = o->osd_addrs;
   }
 
-  // does crush match?
-  ceph::buffer::list oc, nc;
-  encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  // does crush match?  luminous+ maps bump crush_version with every
+  // new crush map, so an equal version means the same map and we can
+  // skip encoding both.
+  if (o->crush != n->crush) {
+    if (o->require_osd_release >= ceph_release_t::luminous &&
+	n->require_osd_release >= ceph_release_t::luminous) {
+      if (o->crush_version == n->crush_version) {
+	n->crush = o->crush;
+      }
+    } else {
+      ceph::buffer::list oc, nc;
+      encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+      encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+      if (oc.contents_equal(nc)) {
+	n->crush = o->crush;
+      }
+    }
   }
 
   // does pg_temp match?
@@ -1897,6 +1909,17 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   if (o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
+
+  // does primary affinity match?
+  if (o->osd_primary_affinity && n->osd_primary_affinity &&
+      *o->osd_primary_affinity == *n->osd_primary_affinity)
+    n->osd_primary_affinity = o->osd_primary_affinity;
+
+  // do upmaps match?
+  if (*o->pg_upmap == *n->pg_upmap)
+    n->pg_upmap = o->pg_upmap;
+  if (*o->pg_upmap_items == *n->pg_upmap_items)
+    n->pg_upmap_items = o->pg_upmap_items;
 }
 
 void OSDMap::clean_temps(CephContext *cct,
@@ -1988,10 +2011,10 @@ void OSDMap::clean_temps(CephContext *cct,
 
 void OSDMap::get_upmap_pgs(vector<pg_t> *upmap_pgs) const
 {
-  upmap_pgs->reserve(pg_upmap.size() + pg_upmap_items.size());
-  for (auto& p : pg_upmap)
+  upmap_pgs->reserve(pg_upmap->size() + pg_upmap_items->size());
+  for (auto& p : *pg_upmap)
     upmap_pgs->push_back(p.first);
-  for (auto& p : pg_upmap_items)
+  for (auto& p : *pg_upmap_items)
     upmap_pgs->push_back(p.first);
 }
 
@@ -2071,8 +2094,8 @@ bool OSDMap::check_pg_upmaps(
       continue;
     // okay, upmap is valid
     // continue to check if it is still necessary
-    auto i = pg_upmap.find(pg);
-    if (i != pg_upmap.end()) {
+    auto i = pg_upmap->find(pg);
+    if (i != pg_upmap->end()) {
       if (i->second == raw) {
         ldout(cct, 10) << "removing redundant pg_upmap " << i->first << " "
                        << i->second << dendl;
@@ -2087,8 +2110,8 @@ bool OSDMap::check_pg_upmaps(
         continue;
       }
     }
-    auto j = pg_upmap_items.find(pg);
-    if (j != pg_upmap_items.end()) {
+    auto j = pg_upmap_items->find(pg);
+    if (j != pg_upmap_items->end()) {
       mempool::osdmap::vector<pair<int,int>> newmap;
       for (auto& p : j->second) {
         if (std::find(raw.begin(), raw.end(), p.first) == raw.end()) {
@@ -2136,8 +2159,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap.erase(i);
     }
-    auto j = pg_upmap.find(pg);
-    if (j != pg_upmap.end()) {
+    auto j = pg_upmap->find(pg);
+    if (j != pg_upmap->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid pg_upmap entry "
                      << j->first << "->" << j->second
                      << dendl;
@@ -2151,8 +2174,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap_items.erase(p);
     }
-    auto q = pg_upmap_items.find(pg);
-    if (q != pg_upmap_items.end()) {
+    auto q = pg_upmap_items->find(pg);
+    if (q != pg_upmap_items->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid "
                      << "pg_upmap_items entry "
                      << q->first << "->" << q->second
@@ -2375,17 +2398,23 @@ int OSDMap::apply_incremental(const Incremental &inc)
       (*primary_temp)[pg.first] = pg.second;
   }
 
-  for (auto& p : inc.new_pg_upmap) {
-    pg_upmap[p.first] = p.second;
-  }
-  for (auto& pg : inc.old_pg_upmap) {
-    pg_upmap.erase(pg);
-  }
-  for (auto& p : inc.new_pg_upmap_items) {
-    pg_upmap_items[p.first] = p.second;
+  if (!inc.new_pg_upmap.empty() || !inc.old_pg_upmap.empty()) {
+    auto& upmap = _unshare(pg_upmap);
+    for (auto& p : inc.new_pg_upmap) {
+      upmap[p.first] = p.second;
+    }
+    for (auto& pg : inc.old_pg_upmap) {
+      upmap.erase(pg);
+    }
   }
-  for (auto& pg : inc.old_pg_upmap_items) {
-    pg_upmap_items.erase(pg);
+  if (!inc.new_pg_upmap_items.empty() || !inc.old_pg_upmap_items.empty()) {
+    auto& upmap_items = _unshare(pg_upmap_items);
+    for (auto& p : inc.new_pg_upmap_items) {
+      upmap_items[p.first] = p.second;
+    }
+    for (auto& pg : inc.old_pg_upmap_items) {
+      upmap_items.erase(pg);
+    }
   }
 
   // blocklist
@@ -2596,8 +2625,8 @@ int OSDMap::_pick_primary(const vector<int>& osds) const
 void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) const
 {
   pg_t pg = pi.raw_pg_to_pg(raw_pg);
-  auto p = pg_upmap.find(pg);
-  if (p != pg_upmap.end()) {
+  auto p = pg_upmap->find(pg);
+  if (p != pg_upmap->end()) {
     // make sure targets aren't marked out
     for (auto osd : p->second) {
       if (osd != CRUSH_ITEM_NONE && osd < max_osd && osd >= 0 &&
@@ -2610,8 +2639,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
     // continue to check and apply pg_upmap_items if any
   }
 
-  auto q = pg_upmap_items.find(pg);
-  if (q != pg_upmap_items.end()) {
+  auto q = pg_upmap_items->find(pg);
+  if (q != pg_upmap_items->end()) {
     // NOTE: this approach does not allow a bidirectional swap,
     // e.g., [[1,2],[2,1]] applied to [0,1,2] -> [0,2,1].
     for (auto& r : q->second) {
@@ -2798,11 +2827,14 @@ void OSDMap::pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const
 void OSDMap::_pg_to_up_acting_osds(
   const pg_t& pg, vector<int> *up, int *up_primary,
   vector<int> *acting, int *acting_primary,
-  bool raw_pg_to_pg) const
+  bool raw_pg_to_pg,
+  vector<int> *raw_upmap) const
 {
   const pg_pool_t *pool = get_pg_pool(pg.pool());
   if (!pool ||
       (!raw_pg_to_pg && pg.ps() >= pool->get_pg_num())) {
+    if (raw_upmap)
+      raw_upmap->clear();
     if (up)
       up->clear();
     if (up_primary)
@@ -2820,9 +2852,11 @@ void OSDMap::_pg_to_up_acting_osds(
   int _acting_primary;
   ps_t pps;
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
-  if (_acting.empty() || up || up_primary) {
+  if (_acting.empty() || up || up_primary || raw_upmap) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
     _apply_upmap(*pool, pg, &raw);
+    if (raw_upmap)
+      *raw_upmap = raw;
     _raw_to_up_osds(*pool, raw, &_up);
     _up_primary = _pick_primary(_up);
     _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
@@ -3133,11 +3167,11 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
     encode(erasure_code_profiles, bl);
 
     if (v >= 4) {
-      encode(pg_upmap, bl);
-      encode(pg_upmap_items, bl);
+      encode(*pg_upmap, bl);
+      encode(*pg_upmap_items, bl);
     } else {
-      ceph_assert(pg_upmap.empty());
-      ceph_assert(pg_upmap_items.empty());
+      ceph_assert(pg_upmap->empty());
+      ceph_assert(pg_upmap_items->empty());
     }
     if (v >= 6) {
       encode(crush_version, bl);
@@ -3462,12 +3496,11 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
     }
     // version increased from 3 to 4 still in luminous, so same as above
     // applies.
+    pg_upmap = std::make_shared<pg_upmap_t>();
+    pg_upmap_items = std::make_shared<pg_upmap_items_t>();
     if (struct_v >= 4) {
-      decode(pg_upmap, bl);
-      decode(pg_upmap_items, bl);
-    } else {
-      pg_upmap.clear();
-      pg_upmap_items.clear();
+      decode(*pg_upmap, bl);
+      decode(*pg_upmap_items, bl);
     }
     // again, version increased from 5 to 6 still in luminous, so above
     // applies.
@@ -3742,7 +3775,7 @@ void OSDMap::dump(Formatter *f) const
   f->close_section();
 
   f->open_array_section("pg_upmap");
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("osds");
@@ -3754,7 +3787,7 @@ void OSDMap::dump(Formatter *f) const
   }
   f->close_section();
   f->open_array_section("pg_upmap_items");
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("mappings");
@@ -4042,10 +4075,10 @@ void OSDMap::print(ostream& out) const
   print_osds(out);
   out << std::endl;
 
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     out << "pg_upmap " << p.first << " " << p.second << "\n";
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     out << "pg_upmap_items " << p.first << " " << p.second << "\n";
   }
 
@@ -4787,7 +4820,7 @@ int OSDMap::calc_pg_upmaps(
     max_deviation = 1;
   tmp_osd_map.deepish_copy_from(*this);
   int num_changed = 0;
-  map<int,set<pg_t>> pgs_by_osd;
+  pgs_by_osd_t pgs_by_osd;
   int total_pgs = 0;
   float osd_weight_total = 0;
   map<int,float> osd_weight;
@@ -4798,7 +4831,7 @@ int OSDMap::calc_pg_upmaps(
   }
 
   osd_weight_total = build_pool_pgs_info(cct, only_pools, tmp_osd_map, 
-                                         total_pgs, pgs_by_osd, osd_weight);
+                                         total_pgs, pgs_by_osd.pgs, osd_weight);
   if (osd_weight_total == 0) {
     lderr(cct) << __func__ << " abort due to osd_weight_total == 0" << dendl;
     return 0;
@@ -4810,10 +4843,14 @@ int OSDMap::calc_pg_upmaps(
 
   float stddev = 0;
   map<int,float> osd_deviation;       // osd, deviation(pgs)
-  multimap<float,int> deviation_osd;  // deviation(pgs), osd
-  float cur_max_deviation = calc_deviations(cct, pgs_by_osd, osd_weight, pgs_per_weight,
+  deviation_osd_t deviation_osd;      // deviation(pgs), osd
+  float cur_max_deviation = calc_deviations(cct, pgs_by_osd.pgs, osd_weight, pgs_per_weight,
 				      	    osd_deviation, deviation_osd, stddev);
 
+  // only pg_upmap_items change from here on, so the raw crush mapping
+  // of a pg stays the same and need not be recomputed on every retry
+  std::unordered_map<pg_t,vector<int>> raw_by_pg;
+
   ldout(cct, 20) << " stdev " << stddev << " max_deviation " << cur_max_deviation << dendl;
   if (cur_max_deviation <= max_deviation) {
     ldout(cct, 10) << __func__ << " distribution is almost perfect"
@@ -4866,7 +4903,10 @@ int OSDMap::calc_pg_upmaps(
 
     set<pg_t> to_unmap;
     map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>> to_upmap;
-    auto temp_pgs_by_osd = pgs_by_osd;
+    // the change is tried on pgs_by_osd in place and rolled back if
+    // it does not help, rather than on a copy of every osd's pgs
+    auto& temp_pgs_by_osd = pgs_by_osd;
+    ceph_assert(pgs_by_osd.moves.empty());
     // always start with fullest, break if we find any changes to make
     for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
       if (skip_overfull && !underfull.empty()) {
@@ -4903,8 +4943,8 @@ int OSDMap::calc_pg_upmaps(
       }
 
       vector<pg_t> pgs;
-      pgs.reserve(pgs_by_osd[osd].size());
-      for (auto& pg : pgs_by_osd[osd]) {
+      pgs.reserve(pgs_by_osd.pgs[osd].size());
+      for (auto& pg : pgs_by_osd.pgs[osd]) {
         if (to_skip.count(pg))
           continue;
         pgs.push_back(pg);
@@ -4920,8 +4960,8 @@ int OSDMap::calc_pg_upmaps(
 
       // try upmap
       for (auto pg : pgs) {
-        auto temp_it = tmp_osd_map.pg_upmap.find(pg);
-        if (temp_it != tmp_osd_map.pg_upmap.end()) {
+        auto temp_it = tmp_osd_map.pg_upmap->find(pg);
+        if (temp_it != tmp_osd_map.pg_upmap->end()) {
           // leave pg_upmap alone
           // it must be specified by admin since balancer does not
           // support pg_upmap yet
@@ -4933,8 +4973,8 @@ int OSDMap::calc_pg_upmaps(
         auto pg_pool_size = tmp_osd_map.get_pg_pool_size(pg);
         mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
         set<int> existing;
-        auto it = tmp_osd_map.pg_upmap_items.find(pg);
-        if (it != tmp_osd_map.pg_upmap_items.end()) {
+        auto it = tmp_osd_map.pg_upmap_items->find(pg);
+        if (it != tmp_osd_map.pg_upmap_items->end()) {
 	  auto& um_items = it->second;
           if (um_items.size() >= (size_t)pg_pool_size) {
             ldout(cct, 10) << " " << pg << " already has full-size pg_upmap_items "
@@ -4956,8 +4996,17 @@ int OSDMap::calc_pg_upmaps(
           // to see if we can append more remapping pairs
 	}
 	ldout(cct, 10) << " trying " << pg << dendl;
-        vector<int> raw, orig, out;
-        tmp_osd_map.pg_to_raw_upmap(pg, &raw, &orig); // including existing upmaps too
+        vector<int> orig, out;
+        auto raw = raw_by_pg.find(pg);
+        if (raw == raw_by_pg.end()) {
+          vector<int> v;
+          int primary;
+          tmp_osd_map.pg_to_raw_osds(pg, &v, &primary);
+          raw = raw_by_pg.emplace(pg, std::move(v)).first;
+        }
+        orig = raw->second;
+        // including existing upmaps too
+        tmp_osd_map._apply_upmap(*tmp_osd_map.get_pg_pool(pg.pool()), pg, &orig);
 	if (!try_pg_upmap(cct, pg, overfull, underfull, more_underfull, &orig, &out)) {
 	  continue;
 	}
@@ -5039,14 +5088,39 @@ int OSDMap::calc_pg_upmaps(
 
     // test change, apply if change is good
     ceph_assert(to_unmap.size() || to_upmap.size());
+    // only the osds the change moved pgs between have a new deviation
+    map<int,float> prev_osd_deviation;
+    for (auto& m : temp_pgs_by_osd.moves) {
+      for (auto oid : {m.from, m.to}) {
+        if (prev_osd_deviation.count(oid))
+          continue;
+        ceph_assert(osd_weight.count(oid));
+        prev_osd_deviation[oid] = osd_deviation.at(oid);
+        float target = osd_weight.at(oid) * pgs_per_weight;
+        float deviation = (float)temp_pgs_by_osd.pgs[oid].size() - target;
+        ldout(cct, 20) << " osd." << oid
+                       << "\tpgs " << temp_pgs_by_osd.pgs[oid].size()
+                       << "\ttarget " << target
+                       << "\tdeviation " << deviation
+                       << dendl;
+        osd_deviation[oid] = deviation;
+      }
+    }
+    // sum in osd order, as calc_deviations() does, so that the result
+    // does not depend on which osds changed
     float new_stddev = 0;
-    map<int,float> temp_osd_deviation;
-    multimap<float,int> temp_deviation_osd;
-    float cur_max_deviation = calc_deviations(cct, temp_pgs_by_osd, osd_weight,
-    					      pgs_per_weight, temp_osd_deviation,
-					      temp_deviation_osd, new_stddev);
+    float cur_max_deviation = 0;
+    for (auto& [oid, deviation] : osd_deviation) {
+      new_stddev += deviation * deviation;
+      if (fabsf(deviation) > cur_max_deviation)
+        cur_max_deviation = fabsf(deviation);
+    }
     ldout(cct, 10) << " stddev " << stddev << " -> " << new_stddev << dendl;
     if (new_stddev >= stddev) {
+      for (auto& [oid, deviation] : prev_osd_deviation) {
+        osd_deviation[oid] = deviation;
+      }
+      temp_pgs_by_osd.rollback();
       if (!aggressive) {
         ldout(cct, 10) << " break because stddev is not decreasing"
                        << " and aggressive mode is not enabled"
@@ -5077,9 +5151,11 @@ int OSDMap::calc_pg_upmaps(
     // ready to go
     ceph_assert(new_stddev < stddev);
     stddev = new_stddev;
-    pgs_by_osd = temp_pgs_by_osd;
-    osd_deviation = temp_osd_deviation;
-    deviation_osd = temp_deviation_osd;
+    temp_pgs_by_osd.commit();
+    for (auto& [oid, deviation] : prev_osd_deviation) {
+      deviation_osd.erase(make_pair(deviation, oid));
+      deviation_osd.insert(make_pair(osd_deviation[oid], oid));
+    }
     n_changes++;
 
 
@@ -5161,7 +5237,7 @@ float OSDMap::calc_deviations (
   const map<int,float>& osd_weight,
   float pgs_per_weight,
   map<int,float>& osd_deviation,
-  multimap<float,int>& deviation_osd,
+  deviation_osd_t& deviation_osd,
   float& stddev)  // return current max deviation
 {
   //
@@ -5196,7 +5272,7 @@ float OSDMap::calc_deviations (
 
 void OSDMap::fill_overfull_underfull (
   CephContext *cct,
-  const std::multimap<float,int>& deviation_osd,
+  const deviation_osd_t& deviation_osd,
   int max_deviation,
   std::set<int>& overfull,
   std::set<int>& more_overfull,
@@ -5251,8 +5327,8 @@ int OSDMap::pack_upmap_results(
   int num_changed = 0;
   for (auto& i : to_unmap) {
     ldout(cct, 10) << " unmap pg " << i << dendl;
-    ceph_assert(tmp_osd_map.pg_upmap_items.count(i));
-    tmp_osd_map.pg_upmap_items.erase(i);
+    ceph_assert(tmp_osd_map.pg_upmap_items->count(i));
+    _unshare(tmp_osd_map.pg_upmap_items).erase(i);
     pending_inc->old_pg_upmap_items.insert(i);
     ++num_changed;
   }
@@ -5260,7 +5336,7 @@ int OSDMap::pack_upmap_results(
     ldout(cct, 10) << " upmap pg " << pg
                    << " new pg_upmap_items " << um_items
                    << dendl;
-    tmp_osd_map.pg_upmap_items[pg] = um_items;
+    _unshare(tmp_osd_map.pg_upmap_items)[pg] = um_items;
     pending_inc->new_pg_upmap_items[pg] = um_items;
     ++num_changed;
   }
@@ -5299,7 +5375,7 @@ bool OSDMap::try_drop_remap_overfull(
   const std::vector<pg_t>& pgs,
   const OSDMap& tmp_osd_map,
   int osd,
-  map<int,std::set<pg_t>>& temp_pgs_by_osd,
+  pgs_by_osd_t& temp_pgs_by_osd,
   set<pg_t>& to_unmap,
   map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>>& to_upmap)
 {
@@ -5309,8 +5385,8 @@ bool OSDMap::try_drop_remap_overfull(
   // if it found an item that can be dropped, false if not. 
   //
   for (auto pg : pgs) {
-    auto p = tmp_osd_map.pg_upmap_items.find(pg);
-    if (p == tmp_osd_map.pg_upmap_items.end())
+    auto p = tmp_osd_map.pg_upmap_items->find(pg);
+    if (p == tmp_osd_map.pg_upmap_items->end())
       continue;
     mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
     auto& pg_upmap_items = p->second;
@@ -5324,8 +5400,7 @@ bool OSDMap::try_drop_remap_overfull(
                        << " which remapped " << pg
                        << " into overfull osd." << osd
                        << dendl;
-        temp_pgs_by_osd[um_to].erase(pg);
-        temp_pgs_by_osd[um_from].insert(pg);
+        temp_pgs_by_osd.move(pg, um_to, um_from);
         } else {
           new_upmap_items.push_back(um_pair);
         }
@@ -5356,7 +5431,7 @@ bool OSDMap::try_drop_remap_underfull(
     CephContext *cct,
     const candidates_t& candidates,
     int osd,
-    map<int,std::set<pg_t>>& temp_pgs_by_osd,
+    pgs_by_osd_t& temp_pgs_by_osd,
     set<pg_t>& to_unmap,
     map<pg_t, mempool::osdmap::vector<std::pair<int32_t,int32_t>>>& to_upmap)
 {
@@ -5377,8 +5452,7 @@ bool OSDMap::try_drop_remap_underfull(
                        << " which remapped " << pg
                        << " out from underfull osd." << osd
                        << dendl;
-        temp_pgs_by_osd[um_to].erase(pg);
-        temp_pgs_by_osd[um_from].insert(pg);
+        temp_pgs_by_osd.move(pg, um_to, um_from);
       } else {
         new_upmap_items.push_back(ump);
       }
@@ -5415,7 +5489,7 @@ void OSDMap::add_remap_pair(
   size_t pg_pool_size,
   int osd,
   set<int>& existing,
-  map<int,set<pg_t>>& temp_pgs_by_osd,
+  pgs_by_osd_t& temp_pgs_by_osd,
   mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items,
   map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>>& to_upmap) 
 {
@@ -5429,8 +5503,7 @@ void OSDMap::add_remap_pair(
                  << dendl;
   existing.insert(orig);
   existing.insert(out);
-  temp_pgs_by_osd[orig].erase(pg);
-  temp_pgs_by_osd[out].insert(pg);
+  temp_pgs_by_osd.move(pg, orig, out);
   ceph_assert(new_upmap_items.size() < pg_pool_size);
   new_upmap_items.push_back(make_pair(orig, out));
   // append new remapping pairs slowly
@@ -5446,7 +5519,7 @@ int OSDMap::find_best_remap (
   const vector<int>& orig,
   const vector<int>& out,
   const set<int>& existing,
-  const map<int,float> osd_deviation) 
+  const map<int,float>& osd_deviation)
 {
   //
   // Find the best remap from the suggestions in orig and out - the best remap 
@@ -5481,8 +5554,8 @@ OSDMap::candidates_t OSDMap::build_candidates(
   // build the candidates data structure
   //
   candidates_t candidates;
-  candidates.reserve(tmp_osd_map.pg_upmap_items.size());
-  for (auto& [pg, um_pair] : tmp_osd_map.pg_upmap_items) {
+  candidates.reserve(tmp_osd_map.pg_upmap_items->size());
+  for (auto& [pg, um_pair] : *tmp_osd_map.pg_upmap_items) {
     if (to_skip.count(pg))
       continue;
     if (!only_pools.empty() && !only_pools.count(pg.pool()))
@@ -572,9 +572,21 @@ private:
   std::shared_ptr< mempool::osdmap::map<pg_t,int32_t > > primary_temp;  // temp primary mapping (e.g. while we rebuild)
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
-  // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
+  // remap (post-CRUSH, pre-up); shared between maps by dedup()
+  typedef mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap_t;
+  typedef mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items_t;
+  std::shared_ptr<pg_upmap_t> pg_upmap; ///< remap pg
+  std::shared_ptr<pg_upmap_items_t> pg_upmap_items; ///< remap osds in up set
+
+  /// a member dedup() may share with other maps, copied if it is
+  /// shared so that modifying it does not change those maps
+  template <typename T>
+  static T& _unshare(std::shared_ptr<T>& p) {
+    if (p.use_count() > 1) {
+      p = std::make_shared<T>(*p);
+    }
+    return *p;
+  }
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,std::string> pool_name;
@@ -654,6 +666,8 @@ private:
   uint32_t crush_version = 1;
 
   friend class OSDMonitor;
+  friend class OSDMapMapping;
+  friend class OSDMapTest;
 
  public:
   OSDMap() : epoch(0), 
@@ -664,6 +678,8 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<pg_upmap_t>()),
+	     pg_upmap_items(std::make_shared<pg_upmap_items_t>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blocklist_entries(false),
@@ -817,7 +833,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
-    (*osd_primary_affinity)[o] = w;
+    _unshare(osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
     ceph_assert(o < max_osd);
@@ -1233,7 +1249,8 @@ private:
    */
   void _pg_to_up_acting_osds(const pg_t& pg, std::vector<int> *up, int *up_primary,
                              std::vector<int> *acting, int *acting_primary,
-			     bool raw_pg_to_pg = true) const;
+			     bool raw_pg_to_pg = true,
+			     std::vector<int> *raw_upmap = nullptr) const;
 
 public:
   /***
@@ -1273,6 +1290,17 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * as above, but also return the raw set (after pg_upmap, before
+   * dropping down osds) the up set was derived from.
+   */
+  void pg_to_raw_up_acting_osds(pg_t pg, std::vector<int> *raw_upmap,
+				std::vector<int> *up, int *up_primary,
+				std::vector<int> *acting,
+				int *acting_primary) const {
+    _pg_to_up_acting_osds(pg, up, up_primary, acting, acting_primary,
+			  true, raw_upmap);
+  }
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
@@ -1463,6 +1491,37 @@ public:
     );
 
 private: // Bunch of internal functions used only by calc_pg_upmaps (result of code refactoring)
+  /// pgs mapped to each osd, with the moves of the change being tested
+  struct pgs_by_osd_t {
+    struct move_t {
+      pg_t pg;
+      int from, to;
+      bool erased, inserted;
+    };
+    std::map<int,std::set<pg_t>> pgs;
+    std::vector<move_t> moves;
+
+    void move(pg_t pg, int from, int to) {
+      bool erased = pgs[from].erase(pg);
+      bool inserted = pgs[to].insert(pg).second;
+      moves.push_back({pg, from, to, erased, inserted});
+    }
+    void rollback() {
+      for (auto m = moves.rbegin(); m != moves.rend(); ++m) {
+	if (m->inserted)
+	  pgs[m->to].erase(m->pg);
+	if (m->erased)
+	  pgs[m->from].insert(m->pg);
+      }
+      moves.clear();
+    }
+    void commit() {
+      moves.clear();
+    }
+  };
+  /// (deviation, osd), ordered like a multimap filled in osd order
+  typedef std::set<std::pair<float,int>> deviation_osd_t;
+
   float build_pool_pgs_info (
     CephContext *cct,
     const std::set<int64_t>& pools,        ///< [optional] restrict to pool
@@ -1478,13 +1537,13 @@ private: // Bunch of internal functions used only by calc_pg_upmaps (result of c
     const std::map<int,float>& osd_weight,
     float pgs_per_weight,
     std::map<int,float>& osd_deviation,
-    std::multimap<float,int>& deviation_osd,
+    deviation_osd_t& deviation_osd,
     float& stddev
   );  // return current max deviation
 
   void fill_overfull_underfull (
     CephContext *cct,
-    const std::multimap<float,int>& deviation_osd,
+    const deviation_osd_t& deviation_osd,
     int max_deviation,
     std::set<int>& overfull,
     std::set<int>& more_overfull,
@@ -1510,7 +1569,7 @@ private: // Bunch of internal functions used only by calc_pg_upmaps (result of c
     const std::vector<pg_t>& pgs,
     const OSDMap& tmp_osd_map,
     int osd,
-    std::map<int,std::set<pg_t>>& temp_pgs_by_osd,
+    pgs_by_osd_t& temp_pgs_by_osd,
     std::set<pg_t>& to_unmap,
     std::map<pg_t, mempool::osdmap::vector<std::pair<int32_t,int32_t>>>& to_upmap
   );
@@ -1522,7 +1581,7 @@ bool try_drop_remap_underfull(
     CephContext *cct,
     const candidates_t& candidates,
     int osd,
-    std::map<int,std::set<pg_t>>& temp_pgs_by_osd,
+    pgs_by_osd_t& temp_pgs_by_osd,
     std::set<pg_t>& to_unmap,
     std::map<pg_t, mempool::osdmap::vector<std::pair<int32_t,int32_t>>>& to_upmap
   );
@@ -1535,7 +1594,7 @@ bool try_drop_remap_underfull(
     size_t pg_pool_size,
     int osd,
     std::set<int>& existing,
-    std::map<int,std::set<pg_t>>& temp_pgs_by_osd,
+    pgs_by_osd_t& temp_pgs_by_osd,
     mempool::osdmap::vector<std::pair<int32_t,int32_t>> new_upmap_items,
     std::map<pg_t, mempool::osdmap::vector<std::pair<int32_t,int32_t>>>& to_upmap
   );
@@ -1545,7 +1604,7 @@ bool try_drop_remap_underfull(
     const std::vector<int>& orig,
     const std::vector<int>& out,
     const std::set<int>& existing,
-    const std::map<int,float> osd_deviation
+    const std::map<int,float>& osd_deviation
   );
 
   candidates_t build_candidates(
@@ -1561,8 +1620,8 @@ public:
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
 
   bool have_pg_upmaps(pg_t pg) const {
-    return pg_upmap.count(pg) ||
-      pg_upmap_items.count(pg);
+    return pg_upmap->count(pg) ||
+      pg_upmap_items->count(pg);
   }
 
   bool check_full(const std::set<pg_shard_t> &missing_on) const {
@@ -59,6 +59,235 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+// the parts of a pool that crush and the temp mappings depend on
+static bool pool_mapping_changed(const pg_pool_t& a, const pg_pool_t& b)
+{
+  return a.get_type() != b.get_type() ||
+    a.get_size() != b.get_size() ||
+    a.get_crush_rule() != b.get_crush_rule() ||
+    a.get_pg_num() != b.get_pg_num() ||
+    a.get_pgp_num() != b.get_pgp_num() ||
+    a.has_flag(pg_pool_t::FLAG_HASHPSPOOL) !=
+      b.has_flag(pg_pool_t::FLAG_HASHPSPOOL);
+}
+
+void OSDMapMapping::note_incremental(
+  const OSDMap& prev,
+  const OSDMap::Incremental& inc)
+{
+  Dirty& d = dirty[inc.epoch];
+  // a deleted pool leaves no pg to remap, but its pgs still have to
+  // go from the reverse map
+  if (inc.fullmap.length() ||
+      inc.crush.length() ||
+      inc.new_max_osd >= 0 ||
+      !inc.old_pools.empty()) {
+    d.all = true;
+    return;
+  }
+
+  for (auto& [pool, pi] : inc.new_pools) {
+    auto old = prev.get_pg_pool(pool);
+    if (!old || pool_mapping_changed(*old, pi)) {
+      d.pools.insert(pool);
+    }
+  }
+
+  // temp mappings and upmaps only affect their own pg
+  for (auto& p : inc.new_pg_temp) {
+    d.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    d.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    d.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    d.pgs.insert(p.first);
+  }
+  d.pgs.insert(inc.old_pg_upmap.begin(), inc.old_pg_upmap.end());
+  d.pgs.insert(inc.old_pg_upmap_items.begin(), inc.old_pg_upmap_items.end());
+
+  // up/down and primary affinity only affect pgs the osd is mapped to
+  for (auto& [osd, state] : inc.new_state) {
+    uint32_t s = state ? state : CEPH_OSD_UP;
+    if (s & CEPH_OSD_EXISTS) {
+      d.all = true;
+      return;
+    }
+    if (s & CEPH_OSD_UP) {
+      d.osds.insert(osd);
+    }
+  }
+  for (auto& p : inc.new_up_client) {
+    if (!prev.exists(p.first)) {
+      d.all = true;
+      return;
+    }
+    d.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    d.osds.insert(p.first);
+  }
+
+  // crush consults the weight of an osd only once it has chosen it,
+  // so lowering a weight can only remap pgs that map to the osd.  An
+  // increase may let crush accept the osd where it was rejected
+  // before, which can remap any pg of a pool whose rule reaches it.
+  std::map<int,std::set<int>> rule_roots;
+  for (auto& [osd, weight] : inc.new_weight) {
+    if (!prev.exists(osd)) {
+      d.all = true;
+      return;
+    }
+    uint32_t old_weight = prev.get_weight(osd);
+    if (weight == old_weight) {
+      continue;
+    }
+    d.osds.insert(osd);
+    // pg_upmap[_items] are ignored if the target is out
+    for (auto& [pgid, osds] : *prev.pg_upmap) {
+      if (std::find(osds.begin(), osds.end(), osd) != osds.end()) {
+	d.pgs.insert(pgid);
+      }
+    }
+    for (auto& [pgid, items] : *prev.pg_upmap_items) {
+      for (auto& [from, to] : items) {
+	if (from == osd || to == osd) {
+	  d.pgs.insert(pgid);
+	  break;
+	}
+      }
+    }
+    if (weight < old_weight) {
+      continue;
+    }
+    for (auto& [pool, pi] : prev.get_pools()) {
+      int rule = pi.get_crush_rule();
+      if (d.pools.count(pool) || !prev.crush->rule_exists(rule)) {
+	continue;
+      }
+      auto r = rule_roots.find(rule);
+      if (r == rule_roots.end()) {
+	r = rule_roots.emplace(rule, std::set<int>()).first;
+	prev.crush->find_takes_by_rule(rule, &r->second);
+      }
+      for (auto root : r->second) {
+	if (root == osd || prev.crush->subtree_contains(root, osd)) {
+	  d.pools.insert(pool);
+	  break;
+	}
+      }
+    }
+  }
+}
+
+// the pgs that may map differently in osdmap than they did in the
+// last completed update, or false if they all have to be mapped
+bool OSDMapMapping::_get_dirty_pgs(const OSDMap& osdmap, vector<pg_t> *pgs)
+{
+  // forget what the mapping already reflects
+  dirty.erase(dirty.begin(), dirty.upper_bound(epoch));
+  if (epoch == 0 ||
+      epoch > osdmap.get_epoch() ||
+      acting_rmap.size() != (size_t)osdmap.get_max_osd()) {
+    return false;
+  }
+
+  Dirty d;
+  epoch_t e = epoch;
+  for (auto& [inc_epoch, i] : dirty) {
+    if (inc_epoch > osdmap.get_epoch()) {
+      break;
+    }
+    if (inc_epoch != e + 1 || i.all) {
+      return false;
+    }
+    e = inc_epoch;
+    d.pools.insert(i.pools.begin(), i.pools.end());
+    d.pgs.insert(i.pgs.begin(), i.pgs.end());
+    d.osds.insert(i.osds.begin(), i.osds.end());
+  }
+  if (e != osdmap.get_epoch()) {
+    return false;
+  }
+
+  for (auto pool : d.pools) {
+    auto pi = osdmap.get_pg_pool(pool);
+    if (!pi) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < pi->get_pg_num(); ++ps) {
+      pgs->push_back(pg_t(ps, pool));
+    }
+  }
+
+  std::set<pg_t> remapped;
+  for (auto& pgid : d.pgs) {
+    auto p = pools.find(pgid.pool());
+    if (p != pools.end() &&
+	!d.pools.count(pgid.pool()) &&
+	pgid.ps() < p->second.pg_num) {
+      remapped.insert(pgid);
+    }
+  }
+  if (!d.osds.empty()) {
+    std::vector<bool> osds(osdmap.get_max_osd());
+    for (auto osd : d.osds) {
+      if (osd >= 0 && osd < osdmap.get_max_osd()) {
+	osds[osd] = true;
+      }
+    }
+    for (auto& [pool, pm] : pools) {
+      if (d.pools.count(pool)) {
+	continue;
+      }
+      for (unsigned ps = 0; ps < pm.pg_num; ++ps) {
+	if (pm.raw_contains_any(ps, osds)) {
+	  remapped.insert(pg_t(ps, pool));
+	}
+      }
+    }
+    // pg_temp drops down osds
+    for (const auto& p : *osdmap.pg_temp) {
+      auto q = pools.find(p.first.pool());
+      if (q == pools.end() ||
+	  d.pools.count(p.first.pool()) ||
+	  p.first.ps() >= q->second.pg_num) {
+	continue;
+      }
+      for (auto osd : p.second) {
+	if (osd >= 0 && osd < osdmap.get_max_osd() && osds[osd]) {
+	  remapped.insert(p.first);
+	  break;
+	}
+      }
+    }
+  }
+  pgs->insert(pgs->end(), remapped.begin(), remapped.end());
+  return true;
+}
+
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item)
+{
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
+  vector<pg_t> pgs;
+  if (!_get_dirty_pgs(map, &pgs)) {
+    mapper.queue(job.get(), pgs_per_item, {});
+  } else if (!pgs.empty()) {
+    mapper.queue(job.get(), pgs_per_item, pgs);
+  } else {
+    // nothing was remapped, so the reverse map is still valid
+    job->finish = ceph_clock_now();
+    epoch = map.get_epoch();
+  }
+  return job;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
@@ -115,13 +344,13 @@ void OSDMapMapping::_update_range(
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
+    std::vector<int> raw, up, acting;
     int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
+    osdmap.pg_to_raw_up_acting_osds(
       pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
+      &raw, &up, &up_primary, &acting, &acting_primary);
     i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+		  std::move(acting), acting_primary, raw);
   }
 }
 
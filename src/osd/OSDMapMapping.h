@@ -7,13 +7,13 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -191,7 +191,8 @@ private:
 	1 + // num acting
 	1 + // num up
 	size + // acting
-	size;  // up
+	size + // up
+	size;  // raw (post-upmap), padded with CRUSH_ITEM_NONE
     }
 
     PoolMapping(int s, int p, bool e)
@@ -231,7 +232,8 @@ private:
 	     const std::vector<int>& up,
 	     int up_primary,
 	     const std::vector<int>& acting,
-	     int acting_primary) {
+	     int acting_primary,
+	     const std::vector<int>& raw) {
       int32_t *row = &table[row_size() * ps];
       row[0] = acting_primary;
       row[1] = up_primary;
@@ -246,6 +248,20 @@ private:
       for (int i = 0; i < row[3]; ++i) {
 	row[4 + size + i] = up[i];
       }
+      for (unsigned i = 0; i < size; ++i) {
+	row[4 + 2 * size + i] = i < raw.size() ? raw[i] : CRUSH_ITEM_NONE;
+      }
+    }
+
+    /// true if the raw set of ps includes any osd set in osds
+    bool raw_contains_any(size_t ps, const std::vector<bool>& osds) const {
+      const int32_t *raw = &table[row_size() * ps + 4 + 2 * size];
+      for (unsigned i = 0; i < size; ++i) {
+	if (raw[i] >= 0 && raw[i] < (int32_t)osds.size() && osds[raw[i]]) {
+	  return true;
+	}
+      }
+      return false;
     }
 
     uint64_t get_num_acting_pgs() const {
@@ -266,6 +282,17 @@ private:
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
 
+  /// what an incremental may have remapped, see note_incremental()
+  struct Dirty {
+    bool all = false;             ///< anything (crush, max_osd, ...)
+    std::set<int64_t> pools;      ///< every pg of these pools
+    std::set<pg_t> pgs;           ///< these pgs
+    std::set<int> osds;           ///< pgs with these in raw or pg_temp
+  };
+  std::map<epoch_t,Dirty> dirty;  ///< by incremental epoch
+
+  bool _get_dirty_pgs(const OSDMap& osdmap, std::vector<pg_t> *pgs);
+
   void _init_mappings(const OSDMap& osdmap);
   void _update_range(
     const OSDMap& map,
@@ -289,7 +316,11 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
-    void process(const std::vector<pg_t>& pgs) override {}
+    void process(const std::vector<pg_t>& pgs) override {
+      for (auto& pgid : pgs) {
+	mapping->_update_range(*osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
+      }
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -348,14 +379,25 @@ public:
 
   void update(const OSDMap& map, pg_t pgid);
 
+  /**
+   * remember which pgs an incremental may remap
+   *
+   * Call with the map the incremental applies to, before applying
+   * it.  If every incremental since the last completed update has
+   * been noted, start_update() only recomputes the pgs they touched
+   * instead of every pg in the map.
+   */
+  void note_incremental(const OSDMap& prev, const OSDMap::Incremental& inc);
+
+  /// forget noted incrementals, the next update will map every pg
+  void clear_incrementals() {
+    dirty.clear();
+  }
+
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
-    unsigned pgs_per_item) {
-    std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item, {});
-    return job;
-  }
+    unsigned pgs_per_item);
 
   epoch_t get_epoch() const {
     return epoch;
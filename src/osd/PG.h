@@ -537,6 +537,8 @@ public:
   void init_collection_pool_opts();
   void on_pool_change() override;
   virtual void plpg_on_pool_change() = 0;
+  /// a config option the pg backend depends on has changed
+  virtual void on_backend_config_change() = 0;
 
   void on_info_history_change() override;
 
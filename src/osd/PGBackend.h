@@ -410,6 +410,10 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
     * won't be called after on_change()
     */
    virtual void on_change() = 0;
+   /**
+    * the pool or a config option the backend depends on may have changed
+    */
+   virtual void on_config_change() {}
    virtual void clear_recovery_state() = 0;
 
    virtual IsPGRecoverablePredicate *get_is_recoverable_predicate() const = 0;
@@ -872,8 +872,28 @@ void PGLog::_write_log_and_missing(
 		     << " dirty_from_dups=" << dirty_from_dups
 		     << " write_from_dups=" << write_from_dups
 		     << " trimmed_dups.size()=" << trimmed_dups.size() << dendl;
+  if (touch_log)
+    t.touch(coll, log_oid);
+
   set<string> to_remove;
+  // trim() only ever drops the oldest log entries and dups, so unless the
+  // log was extended on its tail since, the trimmed keys form one range
+  // below every key we keep.  remove that range with a single op instead
+  // of queueing a removal per key.
+  if (!trimmed_dups.empty() &&
+      (log.dups.empty() ||
+       log.dups.front().get_key_name() > *trimmed_dups.rbegin())) {
+    ldpp_dout(dpp, 20) << __func__ << " removing trimmed dups ["
+		       << *trimmed_dups.begin() << ", "
+		       << *trimmed_dups.rbegin() << "]" << dendl;
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      *trimmed_dups.begin(), key_after(*trimmed_dups.rbegin()));
+    trimmed_dups.clear();
+  }
   to_remove.swap(trimmed_dups);
+  const bool trim_log_range = !trimmed.empty() &&
+    (log.log.empty() || log.log.front().version > *trimmed.rbegin());
   for (auto& t : trimmed) {
     string key = t.get_key_name();
     if (log_keys_debug) {
@@ -881,12 +901,20 @@ void PGLog::_write_log_and_missing(
       ceph_assert(it != log_keys_debug->end());
       log_keys_debug->erase(it);
     }
-    to_remove.emplace(std::move(key));
+    if (!trim_log_range)
+      to_remove.emplace(std::move(key));
+  }
+  if (trim_log_range) {
+    ldpp_dout(dpp, 20) << __func__ << " removing trimmed log entries ["
+		       << *trimmed.begin() << ", "
+		       << *trimmed.rbegin() << "]" << dendl;
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      trimmed.begin()->get_key_name(),
+      key_after(trimmed.rbegin()->get_key_name()));
   }
   trimmed.clear();
 
-  if (touch_log)
-    t.touch(coll, log_oid);
   if (dirty_to != eversion_t()) {
     t.omap_rmkeyrange(
       coll, log_oid,
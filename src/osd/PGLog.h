@@ -21,6 +21,7 @@
 #include "include/common_fwd.h"
 #include "osd_types.h"
 #include "os/ObjectStore.h"
+#include <functional>
 #include <list>
 
 #ifdef WITH_SEASTAR
@@ -112,6 +113,67 @@ constexpr auto PGLOG_INDEXED_ALL              = PGLOG_INDEXED_OBJECTS
                                               | PGLOG_INDEXED_EXTRA_CALLER_OPS 
                                               | PGLOG_INDEXED_DUPS;
 
+/**
+ * pg_log_index_t - in-memory index of log entries (or dups) by a key
+ * that is a member of the indexed value
+ *
+ * The key of each slot borrows the member of the value it points at
+ * rather than holding a copy of it.  For the object index this saves a
+ * whole hobject_t, including its heap allocated name, key and
+ * namespace strings, per logged object; for the reqid indexes it saves
+ * an osd_reqid_t per entry.  Whenever a slot is repointed at another
+ * value the key is repointed as well, so a key never outlives the
+ * value that owns it.
+ */
+template <typename V, typename K, K V::*member>
+class pg_log_index_t {
+  using key_t = std::reference_wrapper<const K>;
+  struct key_hash {
+    size_t operator()(const key_t &k) const {
+      return std::hash<K>{}(k.get());
+    }
+  };
+  struct key_equal {
+    bool operator()(const key_t &l, const key_t &r) const {
+      return l.get() == r.get();
+    }
+  };
+  using map_t = mempool::osd_pglog::unordered_map<
+    key_t, V*, key_hash, key_equal>;
+  map_t m;
+
+public:
+  using iterator = typename map_t::iterator;
+  using const_iterator = typename map_t::const_iterator;
+
+  iterator begin() { return m.begin(); }
+  iterator end() { return m.end(); }
+  const_iterator begin() const { return m.begin(); }
+  const_iterator end() const { return m.end(); }
+  size_t size() const { return m.size(); }
+  bool empty() const { return m.empty(); }
+
+  iterator find(const K &k) { return m.find(key_t(k)); }
+  const_iterator find(const K &k) const { return m.find(key_t(k)); }
+  size_t count(const K &k) const { return m.count(key_t(k)); }
+
+  /// point the slot for v's key at v, re-borrowing the key from v
+  void set(V *v) {
+    const K &k = v->*member;
+    auto it = m.find(key_t(k));
+    if (it == m.end()) {
+      m.emplace(key_t(k), v);
+    } else if (it->second != v) {
+      auto nh = m.extract(it);
+      nh.key() = key_t(k);
+      nh.mapped() = v;
+      m.insert(std::move(nh));
+    }
+  }
+  iterator erase(const_iterator it) { return m.erase(it); }
+  void clear() { m.clear(); }
+};
+
 struct PGLog : DoutPrefixProvider {
   std::ostream& gen_prefix(std::ostream& out) const override {
     return out;
@@ -146,10 +208,17 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
+    using object_index_t =
+      pg_log_index_t<pg_log_entry_t, hobject_t, &pg_log_entry_t::soid>;
+    using caller_op_index_t =
+      pg_log_index_t<pg_log_entry_t, osd_reqid_t, &pg_log_entry_t::reqid>;
+    using dup_index_t =
+      pg_log_index_t<pg_log_dup_t, osd_reqid_t, &pg_log_dup_t::reqid>;
+
+    mutable object_index_t objects;  // ptrs into log.  be careful!
+    mutable caller_op_index_t caller_ops;
     mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    mutable dup_index_t dup_index;
 
     // recovery pointers
     std::list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -239,11 +308,18 @@ public:
       return *this;
     }
 
+    /*
+     * Once the handler has dropped the stashed rollback state of an
+     * entry, its mod_desc can no longer be used to roll the entry back,
+     * so release the rollback description rather than keeping it in
+     * memory for the lifetime of the entry.
+     */
     void trim_rollback_info_to(eversion_t to, LogEntryHandler *h) {
       advance_can_rollback_to(
 	to,
 	[&](pg_log_entry_t &entry) {
 	  h->trim(entry);
+	  entry.mark_unrollbackable();
 	});
     }
     bool roll_forward_to(eversion_t to, LogEntryHandler *h) {
@@ -251,6 +327,7 @@ public:
 	to,
 	[&](pg_log_entry_t &entry) {
 	  h->rollforward(entry);
+	  entry.mark_unrollbackable();
 	});
     }
 
@@ -363,20 +440,20 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS)) {
         index_extra_caller_ops();
       }
-      p = extra_caller_ops.find(r);
-      if (p != extra_caller_ops.end()) {
+      auto e = extra_caller_ops.find(r);
+      if (e != extra_caller_ops.end()) {
 	uint32_t idx = 0;
-	for (auto i = p->second->extra_reqids.begin();
-	     i != p->second->extra_reqids.end();
+	for (auto i = e->second->extra_reqids.begin();
+	     i != e->second->extra_reqids.end();
 	     ++idx, ++i) {
 	  if (i->first == r) {
-	    *version = p->second->version;
+	    *version = e->second->version;
 	    *user_version = i->second;
-	    *return_code = p->second->return_code;
-	    *op_returns = p->second->op_returns;
+	    *return_code = e->second->return_code;
+	    *op_returns = e->second->op_returns;
 	    if (*return_code >= 0) {
-	      auto it = p->second->extra_reqid_return_codes.find(idx);
-	      if (it != p->second->extra_reqid_return_codes.end()) {
+	      auto it = e->second->extra_reqid_return_codes.find(idx);
+	      if (it != e->second->extra_reqid_return_codes.end()) {
 		*return_code = it->second;
 	      }
 	    }
@@ -459,7 +536,7 @@ public:
       if (to_index & PGLOG_INDEXED_DUPS) {
 	dup_index.clear();
 	for (auto& i : dups) {
-	  dup_index[i.reqid] = const_cast<pg_log_dup_t*>(&i);
+	  dup_index.set(const_cast<pg_log_dup_t*>(&i));
 	}
       }
 
@@ -472,13 +549,13 @@ public:
 	for (auto i = log.begin(); i != log.end(); ++i) {
 	  if (to_index & PGLOG_INDEXED_OBJECTS) {
 	    if (i->object_is_indexed()) {
-	      objects[i->soid] = const_cast<pg_log_entry_t*>(&(*i));
+	      objects.set(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
 	  if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	    if (i->reqid_is_indexed()) {
-	      caller_ops[i->reqid] = const_cast<pg_log_entry_t*>(&(*i));
+	      caller_ops.set(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
@@ -514,14 +591,15 @@ public:
 
     void index(pg_log_entry_t& e) {
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        if (objects.count(e.soid) == 0 ||
-            objects[e.soid]->version < e.version)
-          objects[e.soid] = &e;
+        auto it = objects.find(e.soid);
+        if (it == objects.end() ||
+            it->second->version < e.version)
+          objects.set(&e);
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	// divergent merge_log indexes new before unindexing old
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &e;
+	  caller_ops.set(&e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
@@ -574,7 +652,7 @@ public:
 
     void index(pg_log_dup_t& e) {
       if (indexed_data & PGLOG_INDEXED_DUPS) {
-	dup_index[e.reqid] = &e;
+	dup_index.set(&e);
       }
     }
 
@@ -609,11 +687,11 @@ public:
 
       // to our index
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        objects[e.soid] = &(log.back());
+        objects.set(&(log.back()));
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &(log.back());
+	  caller_ops.set(&(log.back()));
         }
       }
 
@@ -723,6 +801,12 @@ protected:
 	 i != log_keys_debug->end();
 	 log_keys_debug->erase(i++));
   }
+  /// smallest omap key sorting after @p key, for inclusive range removals
+  static std::string key_after(const std::string &key) {
+    std::string next = key;
+    next.push_back('\0');
+    return next;
+  }
   static void clear_up_to(std::set<std::string> *log_keys_debug, const std::string &ub) {
     if (!log_keys_debug)
       return;
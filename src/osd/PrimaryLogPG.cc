@@ -13129,6 +13129,12 @@ void PrimaryLogPG::plpg_on_pool_change()
   }
   hit_set_setup();
   agent_setup();
+  pgbackend->on_config_change();
+}
+
+void PrimaryLogPG::on_backend_config_change()
+{
+  pgbackend->on_config_change();
 }
 
 // clear state.  called on recovery completion AND cancellation.
@@ -1889,6 +1889,7 @@ public:
 
   void plpg_on_role_change() override;
   void plpg_on_pool_change() override;
+  void on_backend_config_change() override;
   void clear_async_reads();
   void on_change(ObjectStore::Transaction &t) override;
   void on_activate_complete() override;
@@ -278,6 +278,29 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_ec_read_requested_bytes, "ec_read_requested_bytes",
+    "Bytes requested by client reads from erasure coded pools",
+    NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64_counter(
+    l_osd_ec_read_shard_bytes, "ec_read_shard_bytes",
+    "Shard bytes read to serve client reads from erasure coded pools",
+    NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64_counter(
+    l_osd_ec_read_partial, "ec_read_partial",
+    "Client reads served from a subset of the data shards");
+  osd_plb.add_u64_counter(
+    l_osd_ec_parity_delta_writes, "ec_parity_delta_writes",
+    "Partial stripe overwrites applied to the coding chunks as deltas");
+  osd_plb.add_u64_counter(
+    l_osd_ec_extent_cache_hit_bytes, "ec_extent_cache_hit_bytes",
+    "Read-modify-write bytes found in the erasure coded extent cache",
+    NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64_counter(
+    l_osd_ec_extent_cache_miss_bytes, "ec_extent_cache_miss_bytes",
+    "Read-modify-write bytes read from the shards",
+    NULL, 0, unit_t(UNIT_BYTES));
+
   return osd_plb.create_perf_counters();
 }
  
@@ -118,6 +118,13 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_ec_read_requested_bytes,
+  l_osd_ec_read_shard_bytes,
+  l_osd_ec_read_partial,
+  l_osd_ec_parity_delta_writes,
+  l_osd_ec_extent_cache_hit_bytes,
+  l_osd_ec_extent_cache_miss_bytes,
+
   l_osd_last,
 };
 
@@ -1,8 +1,13 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <future>
+#include <pthread.h>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "common/numa.h"
+#include "include/scope_guard.h"
 
 TEST(cpu_set, parse_list) {
   cpu_set_t cpu_set;
@@ -70,3 +75,81 @@ TEST(cpu_set, round_trip_list)
   }
 }
 
+
+TEST(numa, cpu_numa_node)
+{
+  ASSERT_GT(0, get_cpu_numa_node(-1));
+  unsigned num_cpus = 0;
+  for (int node = 0; node < 1024; ++node) {
+    cpu_set_t cpu_set;
+    size_t size;
+    if (get_numa_node_cpu_set(node, &size, &cpu_set) < 0) {
+      continue;
+    }
+    for (int cpu : cpu_set_to_set(size, &cpu_set)) {
+      ASSERT_EQ(node, get_cpu_numa_node(cpu));
+      ++num_cpus;
+    }
+  }
+  if (num_cpus == 0) {
+    GTEST_SKIP() << "no numa topology in /sys";
+  }
+}
+
+TEST(numa, affinity_skips_prefix)
+{
+  cpu_set_t orig;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(orig), &orig));
+  auto cpus = cpu_set_to_set(CPU_SETSIZE, &orig);
+  if (cpus.size() < 2) {
+    GTEST_SKIP() << "needs two cpus";
+  }
+  cpu_set_t worker_cpu, other_cpu;
+  CPU_ZERO(&worker_cpu);
+  CPU_SET(*cpus.begin(), &worker_cpu);
+  CPU_ZERO(&other_cpu);
+  CPU_SET(*cpus.rbegin(), &other_cpu);
+
+  // a pinned msgr worker, and another thread
+  std::promise<void> stop;
+  std::shared_future<void> stopped = stop.get_future().share();
+  auto spawn = [&](const char *name, const cpu_set_t *cpu_set) {
+    std::promise<void> started;
+    auto f = started.get_future();
+    std::thread t([name, cpu_set, stopped,
+		   started = std::move(started)]() mutable {
+      pthread_setname_np(pthread_self(), name);
+      if (cpu_set) {
+	pthread_setaffinity_np(pthread_self(), sizeof(*cpu_set), cpu_set);
+      }
+      started.set_value();
+      stopped.wait();
+    });
+    f.wait();
+    return t;
+  };
+  std::thread worker = spawn("msgr-worker-0", &worker_cpu);
+  std::thread other = spawn("other", nullptr);
+  auto join = make_scope_guard([&] {
+    set_cpu_affinity_all_threads(sizeof(orig), &orig);
+    stop.set_value();
+    worker.join();
+    other.join();
+  });
+
+  ASSERT_EQ(0, set_cpu_affinity_all_threads(sizeof(other_cpu), &other_cpu,
+					    "msgr-worker-"));
+  cpu_set_t cpu_set;
+  ASSERT_EQ(0, pthread_getaffinity_np(worker.native_handle(),
+				      sizeof(cpu_set), &cpu_set));
+  ASSERT_TRUE(CPU_EQUAL(&worker_cpu, &cpu_set));
+  ASSERT_EQ(0, pthread_getaffinity_np(other.native_handle(),
+				      sizeof(cpu_set), &cpu_set));
+  ASSERT_TRUE(CPU_EQUAL(&other_cpu, &cpu_set));
+
+  // without a prefix every thread is moved
+  ASSERT_EQ(0, set_cpu_affinity_all_threads(sizeof(orig), &orig));
+  ASSERT_EQ(0, pthread_getaffinity_np(worker.native_handle(),
+				      sizeof(cpu_set), &cpu_set));
+  ASSERT_TRUE(CPU_EQUAL(&orig, &cpu_set));
+}
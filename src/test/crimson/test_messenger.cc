@@ -372,6 +372,142 @@ static seastar::future<> test_concurrent_dispatch()
   });
 }
 
+static seastar::future<> test_frame_segments()
+{
+  // {middle, data} lengths of each MPing, whose front is always empty: a
+  // frame with only the header segment has no epilogue in rev1, and the
+  // empty segments in front of a non-empty one are still on the wire with
+  // zero length. The last one is larger than the read-ahead buffer.
+  static const std::vector<std::pair<unsigned, unsigned>> lens = {
+    {0, 0}, {0, 1}, {1, 0}, {0, 4096}, {100, 0}, {0, 0},
+    {100, 4096}, {1, 1}, {0, 0}, {4096, 200 << 10}, {0, 0},
+  };
+
+  struct test_state {
+    static bufferlist make_bl(unsigned idx, unsigned len) {
+      bufferlist bl;
+      for (unsigned i = 0; i < len; ++i) {
+        bl.append(static_cast<char>('a' + (idx + i) % 26));
+      }
+      return bl;
+    }
+
+    struct Server final
+      : public crimson::net::Dispatcher {
+      crimson::net::MessengerRef msgr;
+      unsigned count = 0;
+      seastar::promise<> on_done; // satisfied when all messages arrive
+      crimson::auth::DummyAuthClientServer dummy_auth;
+
+      std::optional<seastar::future<>> ms_dispatch(
+          crimson::net::ConnectionRef, MessageRef m) override {
+        ceph_assert(count < lens.size());
+        auto [middle_len, data_len] = lens[count];
+        if (m->get_type() != CEPH_MSG_PING ||
+            m->get_payload().length() != 0 ||
+            !m->get_middle().contents_equal(
+              test_state::make_bl(count, middle_len)) ||
+            !m->get_data().contents_equal(
+              test_state::make_bl(count + 1, data_len))) {
+          logger().error("test_frame_segments(): message {} got "
+                         "front {}, middle {}, data {}, expected 0, {}, {}",
+                         count, m->get_payload().length(),
+                         m->get_middle().length(), m->get_data().length(),
+                         middle_len, data_len);
+          ceph_abort();
+        }
+        if (++count == lens.size()) {
+          on_done.set_value();
+        }
+        return {seastar::now()};
+      }
+
+      seastar::future<> wait() { return on_done.get_future(); }
+
+      seastar::future<> init(const entity_name_t& name,
+                             const std::string& lname,
+                             const uint64_t nonce,
+                             const entity_addr_t& addr) {
+        msgr = crimson::net::Messenger::create(name, lname, nonce);
+        msgr->set_default_policy(crimson::net::SocketPolicy::stateless_server(0));
+        msgr->set_auth_client(&dummy_auth);
+        msgr->set_auth_server(&dummy_auth);
+        return msgr->bind(entity_addrvec_t{addr}).safe_then([this] {
+          return msgr->start({this});
+        }, crimson::net::Messenger::bind_ertr::all_same_way(
+            [addr] (const std::error_code& e) {
+          logger().error("test_frame_segments(): "
+                         "there is another instance running at {}", addr);
+          ceph_abort();
+        }));
+      }
+    };
+
+    struct Client final
+      : public crimson::net::Dispatcher {
+      crimson::net::MessengerRef msgr;
+      crimson::auth::DummyAuthClientServer dummy_auth;
+
+      std::optional<seastar::future<>> ms_dispatch(
+          crimson::net::ConnectionRef, MessageRef m) override {
+        return {seastar::now()};
+      }
+
+      seastar::future<> init(const entity_name_t& name,
+                             const std::string& lname,
+                             const uint64_t nonce) {
+        msgr = crimson::net::Messenger::create(name, lname, nonce);
+        msgr->set_default_policy(crimson::net::SocketPolicy::lossy_client(0));
+        msgr->set_auth_client(&dummy_auth);
+        msgr->set_auth_server(&dummy_auth);
+        return msgr->start({this});
+      }
+    };
+  };
+
+  logger().info("test_frame_segments():");
+  auto server = seastar::make_shared<test_state::Server>();
+  auto client = seastar::make_shared<test_state::Client>();
+  auto addr = get_server_addr();
+  addr.set_type(entity_addr_t::TYPE_MSGR2);
+  addr.set_family(AF_INET);
+  return seastar::when_all_succeed(
+      server->init(entity_name_t::OSD(8), "server5", 9, addr),
+      client->init(entity_name_t::OSD(9), "client5", 10)
+  ).then_unpack([server, client] {
+    auto conn = client->msgr->connect(server->msgr->get_myaddr(),
+                                      entity_name_t::TYPE_OSD);
+    std::vector<MessageURef> msgs;
+    for (unsigned idx = 0; idx < lens.size(); ++idx) {
+      auto m = crimson::make_message<MPing>();
+      auto middle = test_state::make_bl(idx, lens[idx].first);
+      m->set_middle(middle);
+      m->set_data(test_state::make_bl(idx + 1, lens[idx].second));
+      msgs.push_back(std::move(m));
+    }
+    return seastar::do_with(std::move(msgs), [conn] (auto& msgs) {
+      return seastar::do_for_each(msgs, [conn] (auto& m) {
+        return conn->send(std::move(m));
+      });
+    });
+  }).then([server] {
+    return server->wait();
+  }).then([client] {
+    logger().info("client shutdown...");
+    client->msgr->stop();
+    return client->msgr->shutdown();
+  }).then([server] {
+    logger().info("server shutdown...");
+    server->msgr->stop();
+    return server->msgr->shutdown();
+  }).then([] {
+    logger().info("test_frame_segments() done!\n");
+  }).handle_exception([server, client] (auto eptr) {
+    logger().error("test_frame_segments() failed: got exception {}", eptr);
+    throw;
+  });
+}
+
 seastar::future<> test_preemptive_shutdown() {
   struct test_state {
     class Server final
@@ -3601,6 +3737,8 @@ seastar::future<int> do_test(seastar::app_template& app)
     return test_echo(rounds, keepalive_ratio)
     .then([] {
       return test_concurrent_dispatch();
+    }).then([] {
+      return test_frame_segments();
     }).then([] {
       return test_preemptive_shutdown();
     }).then([v2_test_addr, v2_testpeer_addr, v2_testpeer_islocal] {
@@ -513,6 +513,22 @@ double calc_straw2_stddev(int *weights, int n, bool verbose)
   return stddev;
 }
 
+TEST_F(CRUSHTest, hash32_3_batch)
+{
+  // straw2 relies on the batch being bit-identical to the scalar hash
+  vector<__u32> ids(200), out(200);
+  for (unsigned i = 0; i < ids.size(); ++i)
+    ids[i] = i % 3 ? rand() : -(int)i;
+  for (unsigned n : {0u, 1u, 7u, 8u, 9u, 64u, 65u, 200u}) {
+    __u32 x = rand(), r = rand() % 10;
+    crush_hash32_3_batch(CRUSH_HASH_RJENKINS1, x, ids.data(), r,
+			 out.data(), n);
+    for (unsigned i = 0; i < n; ++i)
+      ASSERT_EQ(crush_hash32_3(CRUSH_HASH_RJENKINS1, x, ids[i], r), out[i])
+	<< "n " << n << " i " << i;
+  }
+}
+
 TEST_F(CRUSHTest, straw2_stddev)
 {
   int n = 15;
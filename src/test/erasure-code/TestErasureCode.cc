@@ -18,6 +18,7 @@
 #include <stdlib.h>
 
 #include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodeDecodeCache.h"
 #include "global/global_context.h"
 #include "common/config.h"
 #include "gtest/gtest.h"
@@ -158,6 +159,53 @@ TEST(ErasureCodeTest, encode_misaligned_non_contiguous)
   }
 }
 
+TEST(ErasureCodeTest, encode_stripes_without_batch)
+{
+  // without FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION each stripe is
+  // encoded on its own and the chunks are appended
+  unsigned chunk_size = 16;
+  ErasureCodeTest erasure_code(2, 1, chunk_size);
+  bufferlist in;
+  for (int i = 0; i < 3 * 2 * 16; i++)
+    in.append('A' + i % 26);
+  set<int> want_to_encode = { 0, 1, 2 };
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, erasure_code.encode_stripes(3, want_to_encode, in, &encoded));
+  ASSERT_EQ(3u, encoded.size());
+  for (unsigned s = 0; s < 3; s++) {
+    for (unsigned i = 0; i < 2; i++) {
+      bufferlist expected, chunk;
+      expected.substr_of(in, (s * 2 + i) * chunk_size, chunk_size);
+      chunk.substr_of(encoded[i], s * chunk_size, chunk_size);
+      EXPECT_TRUE(expected.contents_equal(chunk));
+    }
+  }
+  EXPECT_EQ(3 * chunk_size, encoded[2].length());
+}
+
+TEST(ErasureCodeTest, decode_cache_lru)
+{
+  ErasureCodeDecodeCache<int> cache(2);
+  EXPECT_FALSE(cache.get("a"));
+  EXPECT_EQ(1, *cache.put("a", std::make_shared<int>(1)));
+  EXPECT_EQ(2, *cache.put("b", std::make_shared<int>(2)));
+  // a racing put keeps the first table
+  EXPECT_EQ(1, *cache.put("a", std::make_shared<int>(10)));
+  // a is now the most recently used, c evicts b
+  auto b = cache.get("b");
+  EXPECT_EQ(2, *b);
+  EXPECT_EQ(1, *cache.get("a"));
+  cache.put("c", std::make_shared<int>(3));
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_FALSE(cache.get("b"));
+  EXPECT_EQ(1, *cache.get("a"));
+  EXPECT_EQ(3, *cache.get("c"));
+  // an evicted table stays valid for its users
+  EXPECT_EQ(2, *b);
+  EXPECT_EQ(4u, cache.get_hits());
+  EXPECT_EQ(2u, cache.get_misses());
+}
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
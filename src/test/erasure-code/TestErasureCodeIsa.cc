@@ -34,6 +34,7 @@ class IsaErasureCodeTest : public ::testing::Test {
 public:
   void compare_chunks(bufferlist &in, map<int, bufferlist> &encoded);
   void encode_decode(unsigned object_size); 
+  void parity_delta(int matrix, const char *k, const char *m);
 };
 
 void IsaErasureCodeTest::compare_chunks(bufferlist &in, map<int, bufferlist> &encoded)
@@ -876,6 +877,64 @@ TEST_F(IsaErasureCodeTest, isa_xor_codec)
   EXPECT_EQ(5, cnt_cf);
 }
 
+void IsaErasureCodeTest::parity_delta(int matrix, const char *k, const char *m)
+{
+  ErasureCodeIsaDefault Isa(tcache, matrix);
+  ErasureCodeProfile profile;
+  profile["k"] = k;
+  profile["m"] = m;
+  Isa.init(profile, &cerr);
+  ASSERT_TRUE(Isa.get_supported_optimizations() &
+	      ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION);
+
+  const unsigned data_chunks = Isa.get_data_chunk_count();
+  const unsigned chunk_count = Isa.get_chunk_count();
+  bufferlist in;
+  for (unsigned i = 0; i < data_chunks * EC_ISA_ADDRESS_ALIGNMENT * 4; i++)
+    in.append((char)(i * 7 + 3));
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < chunk_count; i++)
+    want_to_encode.insert(i);
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+  unsigned length = encoded[0].length();
+
+  // overwrite the first and the last data chunks
+  bufferlist updated;
+  map<int, bufferptr> deltas;
+  for (unsigned i = 0; i < data_chunks; i++) {
+    bufferptr chunk(encoded[i].c_str(), length);
+    if (i == 0 || i == data_chunks - 1) {
+      for (unsigned j = length / 4; j < length; j++)
+	chunk[j] = (char)(i + j * 13);
+      Isa.encode_delta(bufferptr(encoded[i].c_str(), length), chunk,
+		       &deltas[i]);
+    }
+    updated.append(chunk);
+  }
+
+  // leave out one coding chunk to exercise the scratch buffers
+  map<int, bufferptr> parity;
+  for (unsigned i = data_chunks; i < chunk_count - 1; i++)
+    parity[i] = bufferptr(encoded[i].c_str(), length);
+  if (parity.empty())
+    parity[data_chunks] = bufferptr(encoded[data_chunks].c_str(), length);
+  EXPECT_EQ(0, Isa.apply_delta(deltas, parity));
+
+  map<int, bufferlist> reencoded;
+  EXPECT_EQ(0, Isa.encode(want_to_encode, updated, &reencoded));
+  for (auto &&[i, p] : parity) {
+    EXPECT_EQ(0, memcmp(p.c_str(), reencoded[i].c_str(), length));
+  }
+}
+
+TEST_F(IsaErasureCodeTest, parity_delta)
+{
+  parity_delta(ErasureCodeIsaDefault::kVandermonde, "4", "2");
+  parity_delta(ErasureCodeIsaDefault::kCauchy, "6", "3");
+  parity_delta(ErasureCodeIsaDefault::kVandermonde, "4", "1");
+}
+
 TEST_F(IsaErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
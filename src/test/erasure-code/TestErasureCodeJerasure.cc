@@ -21,6 +21,7 @@
 #include "crush/CrushWrapper.h"
 #include "include/stringify.h"
 #include "erasure-code/jerasure/ErasureCodeJerasure.h"
+#include "erasure-code/jerasure/gf8_region.h"
 #include "global/global_context.h"
 #include "common/config.h"
 #include "gtest/gtest.h"
@@ -130,6 +131,144 @@ TYPED_TEST(ErasureCodeTest, encode_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, encode_decode_stripes)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+  EXPECT_TRUE(jerasure.get_supported_optimizations() &
+	      ErasureCodeInterface::FLAG_EC_PLUGIN_STRIPE_BATCH_OPTIMIZATION);
+
+  unsigned chunk_size = jerasure.get_chunk_size(1);
+  unsigned stripe_width = 2 * chunk_size;
+  ASSERT_EQ(chunk_size, jerasure.get_chunk_size(stripe_width));
+  const unsigned stripe_count = 5;
+  bufferlist in;
+  for (unsigned i = 0; i < stripe_count * stripe_width; i++)
+    in.append((char)rand());
+  set<int> want_to_encode = { 0, 1, 2, 3 };
+
+  // one stripe at a time
+  map<int, bufferlist> expected;
+  for (unsigned s = 0; s < stripe_count; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int, bufferlist> encoded;
+    ASSERT_EQ(0, jerasure.encode(want_to_encode, stripe, &encoded));
+    for (auto &&[shard, bl] : encoded)
+      expected[shard].claim_append(bl);
+  }
+
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, jerasure.encode_stripes(stripe_count, want_to_encode,
+				       in, &encoded));
+  ASSERT_EQ(4u, encoded.size());
+  for (auto &&[shard, bl] : expected)
+    EXPECT_TRUE(bl.contents_equal(encoded[shard])) << "shard " << shard;
+
+  map<int, bufferlist> degraded = encoded;
+  degraded.erase(0);
+  degraded.erase(3);
+  map<int, bufferlist> decoded;
+  ASSERT_EQ(0, jerasure.decode_stripes(stripe_count, want_to_encode,
+				       degraded, &decoded));
+  for (auto &&[shard, bl] : expected)
+    EXPECT_TRUE(bl.contents_equal(decoded[shard])) << "shard " << shard;
+}
+
+TYPED_TEST(ErasureCodeTest, decode_cache)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "3";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+
+  bufferlist in;
+  for (int i = 0; i < 3 * 1024; i++)
+    in.append((char)rand());
+  set<int> want_to_encode = { 0, 1, 2, 3, 4 };
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+
+  auto &cache = ErasureCodeJerasure::decode_cache();
+  cache.clear();
+  // every combination of one or two erasures, twice
+  for (int pass = 0; pass < 2; pass++) {
+    for (int a = 0; a < 5; a++) {
+      for (int b = a; b < 5; b++) {
+	map<int, bufferlist> degraded = encoded;
+	degraded.erase(a);
+	degraded.erase(b);
+	map<int, bufferlist> decoded;
+	EXPECT_EQ(0, jerasure._decode(want_to_encode, degraded, &decoded));
+	for (int i = 0; i < 5; i++)
+	  EXPECT_TRUE(encoded[i].contents_equal(decoded[i]))
+	    << "erased " << a << "," << b << " chunk " << i;
+      }
+    }
+  }
+  EXPECT_EQ(15u, cache.size());
+  EXPECT_EQ(15u, cache.get_misses());
+  EXPECT_EQ(15u, cache.get_hits());
+}
+
+TYPED_TEST(ErasureCodeTest, parity_delta)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+  if (!(jerasure.get_supported_optimizations() &
+	ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION)) {
+    map<int, bufferptr> parity;
+    EXPECT_EQ(-EOPNOTSUPP, jerasure.apply_delta({}, parity));
+    return;
+  }
+
+  bufferlist in;
+  for (unsigned i = 0; i < 4 * jerasure.get_alignment(); i++)
+    in.append((char)(i * 7 + 3));
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < jerasure.get_chunk_count(); i++)
+    want_to_encode.insert(i);
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+  unsigned length = encoded[0].length();
+
+  map<int, bufferptr> parity;
+  for (int i = 4; i < 6; i++) {
+    parity[i] = bufferptr(encoded[i].c_str(), length);
+  }
+  // overwrite part of chunk 1 and update the parity from the delta only
+  bufferlist updated;
+  updated.substr_of(in, 0, length);
+  bufferptr new_chunk(in.c_str() + length, length);
+  for (unsigned i = 0; i < length / 2; i++)
+    new_chunk[i] = (char)(i * 13 + 1);
+  updated.append(new_chunk);
+  bufferlist tail;
+  tail.substr_of(in, 2 * length, in.length() - 2 * length);
+  updated.append(tail);
+
+  bufferptr delta;
+  jerasure.encode_delta(bufferptr(encoded[1].c_str(), length),
+			new_chunk, &delta);
+  EXPECT_EQ(0, jerasure.apply_delta({{1, delta}}, parity));
+
+  map<int, bufferlist> reencoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, updated, &reencoded));
+  for (int i = 4; i < 6; i++) {
+    EXPECT_EQ(0, memcmp(parity[i].c_str(), reencoded[i].c_str(), length));
+  }
+}
+
 TYPED_TEST(ErasureCodeTest, minimum_to_decode)
 {
   TypeParam jerasure;
@@ -278,6 +417,97 @@ TEST(ErasureCodeTest, encode)
   }
 }
 
+TEST(ErasureCodeTest, region_kernels)
+{
+  for (const char *name : { "ssse3", "avx2", "avx512", "gfni" }) {
+    const gf8_region_kernel *kernel = gf8_region_kernel_find(name);
+    if (!kernel)
+      continue;
+    SCOPED_TRACE(name);
+    // lengths that are not a multiple of the vector size use the tail
+    for (size_t len : { 1, 63, 64, 4096 + 17 }) {
+      vector<uint8_t> src(len), dst(len), expected(len);
+      for (size_t i = 0; i < len; i++) {
+	src[i] = rand();
+	dst[i] = rand();
+      }
+      for (int c = 0; c < 256; c++) {
+	for (size_t i = 0; i < len; i++)
+	  expected[i] = dst[i] ^ gf8_mul(c, src[i]);
+	kernel->multiply(src.data(), dst.data(), len, c, true);
+	ASSERT_EQ(expected, dst);
+	for (size_t i = 0; i < len; i++)
+	  expected[i] = gf8_mul(c, src[i]);
+	kernel->multiply(src.data(), dst.data(), len, c, false);
+	ASSERT_EQ(expected, dst);
+      }
+      for (size_t i = 0; i < len; i++)
+	expected[i] = dst[i] ^ src[i];
+      kernel->xor_region(src.data(), dst.data(), len);
+      ASSERT_EQ(expected, dst);
+    }
+  }
+}
+
+template <typename T>
+static void encode_with_simd(const string &simd, unsigned k, unsigned m,
+			     const bufferlist &in, map<int,bufferlist> *encoded)
+{
+  T jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = stringify(k);
+  profile["m"] = stringify(m);
+  profile["w"] = "8";
+  profile["jerasure-simd"] = simd;
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < k + m; i++)
+    want_to_encode.insert(i);
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, in, encoded));
+}
+
+TEST(ErasureCodeTest, encode_simd)
+{
+  bufferlist in;
+  for (int i = 0; i < 3 * 4096 + 100; i++)
+    in.append((char)rand());
+  map<int,bufferlist> reference;
+  encode_with_simd<ErasureCodeJerasureReedSolomonVandermonde>(
+    "none", 4, 3, in, &reference);
+  map<int,bufferlist> raid6_reference;
+  encode_with_simd<ErasureCodeJerasureReedSolomonRAID6>(
+    "none", 4, 2, in, &raid6_reference);
+  for (const char *name : { "ssse3", "avx2", "avx512", "gfni" }) {
+    if (!gf8_region_kernel_find(name))
+      continue;
+    SCOPED_TRACE(name);
+    map<int,bufferlist> encoded;
+    encode_with_simd<ErasureCodeJerasureReedSolomonVandermonde>(
+      name, 4, 3, in, &encoded);
+    for (auto &&[shard, bl] : reference)
+      EXPECT_TRUE(bl.contents_equal(encoded[shard]));
+    encoded.clear();
+    encode_with_simd<ErasureCodeJerasureReedSolomonRAID6>(
+      name, 4, 2, in, &encoded);
+    for (auto &&[shard, bl] : raid6_reference)
+      EXPECT_TRUE(bl.contents_equal(encoded[shard]));
+  }
+
+  {
+    // a profile that does not ask for a kernel is left without one
+    ErasureCodeJerasureReedSolomonVandermonde jerasure;
+    ErasureCodeProfile profile;
+    EXPECT_EQ(0, jerasure.init(profile, &cerr));
+    EXPECT_EQ(0u, jerasure.get_profile().count("jerasure-simd"));
+  }
+
+  ErasureCodeJerasureReedSolomonVandermonde jerasure;
+  ErasureCodeProfile profile;
+  profile["jerasure-simd"] = "mmx";
+  stringstream ss;
+  EXPECT_EQ(-EINVAL, jerasure.init(profile, &ss));
+}
+
 TEST(ErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
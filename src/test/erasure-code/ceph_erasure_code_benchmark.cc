@@ -30,6 +30,7 @@
 #include "common/ceph_context.h"
 #include "common/config.h"
 #include "common/Clock.h"
+#include "common/Formatter.h"
 #include "include/utime.h"
 #include "erasure-code/ErasureCodePlugin.h"
 #include "erasure-code/ErasureCode.h"
@@ -71,6 +72,9 @@ int ErasureCodeBench::setup(int argc, char** argv) {
      " the first chunk, then the second etc.)")
     ("parameter,P", po::value<vector<string> >(),
      "add a parameter to the erasure code profile")
+    ("format,f", po::value<string>()->default_value("plain"),
+     "output format: 'plain' prints the seconds and KB processed, "
+     "'json' prints one object describing the run")
     ;
 
   po::variables_map vm;
@@ -123,6 +127,11 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   plugin = vm["plugin"].as<string>();
   workload = vm["workload"].as<string>();
   erasures = vm["erasures"].as<int>();
+  format = vm["format"].as<string>();
+  if (format != "plain" && format != "json") {
+    cout << "--format " << format << " must be one of {plain, json}" << endl;
+    return -EINVAL;
+  }
   if (vm.count("erasures-generation") > 0 &&
       vm["erasures-generation"].as<string>() == "exhaustive")
     exhaustive_erasures = true;
@@ -190,10 +199,39 @@ int ErasureCodeBench::encode()
       return code;
   }
   utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  report(end_time - begin_time);
   return 0;
 }
 
+void ErasureCodeBench::report(utime_t elapsed)
+{
+  uint64_t kb = (uint64_t)max_iterations * (in_size / 1024);
+  if (format == "plain") {
+    cout << elapsed << "\t" << kb << endl;
+    return;
+  }
+  ceph::JSONFormatter f;
+  f.open_object_section("benchmark");
+  f.dump_string("plugin", plugin);
+  f.dump_string("workload", workload);
+  f.dump_int("k", k);
+  f.dump_int("m", m);
+  f.dump_int("size", in_size);
+  f.dump_int("iterations", max_iterations);
+  f.dump_int("erasures", workload == "encode" ? 0 : erasures);
+  f.dump_float("seconds", (double)elapsed);
+  f.dump_unsigned("kb", kb);
+  f.dump_float("mb_per_second",
+	       (double)elapsed > 0 ? kb / 1024.0 / (double)elapsed : 0);
+  f.open_object_section("profile");
+  for (auto &&[name, value] : profile)
+    f.dump_string(name.c_str(), value);
+  f.close_section();
+  f.close_section();
+  f.flush(cout);
+  cout << endl;
+}
+
 static void display_chunks(const map<int,bufferlist> &chunks,
 			   unsigned int chunk_count) {
   cout << "chunks ";
@@ -321,7 +359,7 @@ int ErasureCodeBench::decode()
     }
   }
   utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  report(end_time - begin_time);
   return 0;
 }
 
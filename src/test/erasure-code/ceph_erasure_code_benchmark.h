@@ -27,6 +27,7 @@
 #include "include/buffer.h"
 
 #include "common/ceph_context.h"
+#include "include/utime.h"
 
 #include "erasure-code/ErasureCodeInterface.h"
 
@@ -42,6 +43,7 @@ class ErasureCodeBench {
   bool exhaustive_erasures;
   std::vector<int> erased;
   std::string workload;
+  std::string format;
 
   ceph::ErasureCodeProfile profile;
 
@@ -57,6 +59,7 @@ public:
 		      ErasureCodeInterfaceRef erasure_code);
   int decode();
   int encode();
+  void report(utime_t elapsed);
 };
 
 #endif
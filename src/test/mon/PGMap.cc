@@ -167,3 +167,84 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+// apply_incremental() keeps the per-osd indexes in step with
+// calc_stats(), whether or not an update moves the pg
+TEST(pgmap, apply_incremental_pg_by_osd)
+{
+  PGMap pg_map;
+  auto apply = [&](std::function<void(PGMap::Incremental&)> f) {
+    PGMap::Incremental inc;
+    inc.version = pg_map.version + 1;
+    inc.stamp = utime_t(pg_map.version + 1, 0);
+    f(inc);
+    pg_map.apply_incremental(nullptr, inc);
+  };
+  auto stat = [](vector<int32_t> up, vector<int32_t> acting) {
+    pg_stat_t s;
+    s.state = PG_STATE_ACTIVE;
+    s.up = up;
+    s.acting = acting;
+    s.up_primary = up[0];
+    s.acting_primary = acting[0];
+    return s;
+  };
+  auto check = [&]() {
+    PGMap calc;
+    calc.pg_stat = pg_map.pg_stat;
+    calc.calc_stats();
+    ASSERT_EQ(calc.pg_by_osd, pg_map.pg_by_osd);
+    for (int osd = 0; osd < 5; ++osd) {
+      auto p = calc.num_pg_by_osd.find(osd);
+      auto q = pg_map.num_pg_by_osd.find(osd);
+      PGMap::pg_count a, b;
+      if (p != calc.num_pg_by_osd.end())
+	a = p->second;
+      if (q != pg_map.num_pg_by_osd.end())
+	b = q->second;
+      ASSERT_EQ(a.acting, b.acting) << "osd." << osd;
+      ASSERT_EQ(a.up_not_acting, b.up_not_acting) << "osd." << osd;
+      ASSERT_EQ(a.primary, b.primary) << "osd." << osd;
+    }
+  };
+
+  pg_t a(0, 1), b(1, 1);
+  apply([&](PGMap::Incremental& inc) {
+    inc.pg_stat_updates[a] = stat({0, 1, 2}, {0, 1, 2});
+    inc.pg_stat_updates[b] = stat({1, 2, 3}, {1, 2, 3});
+  });
+  check();
+
+  // same osds, new stats
+  apply([&](PGMap::Incremental& inc) {
+    auto s = stat({0, 1, 2}, {0, 1, 2});
+    s.stats.sum.num_objects = 10;
+    inc.pg_stat_updates[a] = s;
+  });
+  check();
+  ASSERT_EQ(10, pg_map.pg_sum.stats.sum.num_objects);
+
+  // remapped, then back again
+  apply([&](PGMap::Incremental& inc) {
+    inc.pg_stat_updates[a] = stat({0, 1, 4}, {0, 1, 2});
+  });
+  check();
+  apply([&](PGMap::Incremental& inc) {
+    inc.pg_stat_updates[a] = stat({0, 1, 4}, {0, 1, 4});
+  });
+  check();
+
+  // blocked
+  apply([&](PGMap::Incremental& inc) {
+    auto s = stat({1, 2, 3}, {1, 2, 3});
+    s.blocked_by.push_back(4);
+    inc.pg_stat_updates[b] = s;
+  });
+  check();
+  ASSERT_EQ(1, pg_map.blocked_by_sum[4]);
+  apply([&](PGMap::Incremental& inc) {
+    inc.pg_stat_updates[b] = stat({1, 2, 3}, {1, 2, 3});
+  });
+  check();
+  ASSERT_EQ(0u, pg_map.blocked_by_sum.count(4));
+}
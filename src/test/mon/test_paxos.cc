@@ -0,0 +1,102 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#include "mon/PaxosService.h"
+
+#include "gtest/gtest.h"
+
+static constexpr double propose_interval = 1.0;
+static constexpr double min_wait = 0.05;
+
+TEST(paxos, round_latency_average) {
+  // the first round is taken as is
+  double avg = Paxos::update_round_latency(0, 0.2, min_wait,
+					   propose_interval);
+  ASSERT_DOUBLE_EQ(0.2, avg);
+  // later ones are folded in
+  avg = Paxos::update_round_latency(avg, 0.6, min_wait, propose_interval);
+  ASSERT_DOUBLE_EQ(0.3, avg);
+  // and the average follows them
+  for (int i = 0; i < 50; ++i) {
+    avg = Paxos::update_round_latency(avg, 0.1, min_wait, propose_interval);
+  }
+  ASSERT_NEAR(0.1, avg, 1e-6);
+}
+
+TEST(paxos, round_latency_clamped) {
+  // a stalled round does not push the average past the propose interval
+  double avg = Paxos::update_round_latency(0, 30, min_wait,
+					   propose_interval);
+  ASSERT_DOUBLE_EQ(propose_interval, avg);
+  avg = Paxos::update_round_latency(0.1, 30, min_wait, propose_interval);
+  ASSERT_DOUBLE_EQ(propose_interval, avg);
+  // nor does a fast one take it below the minimum wait
+  avg = Paxos::update_round_latency(0, 0.001, min_wait, propose_interval);
+  ASSERT_DOUBLE_EQ(min_wait, avg);
+  for (int i = 0; i < 50; ++i) {
+    avg = Paxos::update_round_latency(avg, 0, min_wait, propose_interval);
+  }
+  ASSERT_DOUBLE_EQ(min_wait, avg);
+  // a minimum wait above the propose interval wins
+  avg = Paxos::update_round_latency(0, 0.5, 2 * propose_interval,
+				    propose_interval);
+  ASSERT_DOUBLE_EQ(2 * propose_interval, avg);
+}
+
+TEST(paxos_service, propose_interval_fixed) {
+  // not adaptive
+  ASSERT_DOUBLE_EQ(propose_interval,
+		   PaxosService::get_propose_interval(
+		     propose_interval, min_wait, 0.01, false));
+  // adaptive, but no round completed yet
+  ASSERT_DOUBLE_EQ(propose_interval,
+		   PaxosService::get_propose_interval(
+		     propose_interval, min_wait, 0, true));
+}
+
+TEST(paxos_service, propose_interval_adaptive) {
+  // four rounds
+  ASSERT_DOUBLE_EQ(0.2,
+		   PaxosService::get_propose_interval(
+		     propose_interval, min_wait, 0.05, true));
+  // no shorter than the minimum wait
+  ASSERT_DOUBLE_EQ(min_wait,
+		   PaxosService::get_propose_interval(
+		     propose_interval, min_wait, 0.001, true));
+  // no longer than the propose interval
+  ASSERT_DOUBLE_EQ(propose_interval,
+		   PaxosService::get_propose_interval(
+		     propose_interval, min_wait, 0.5, true));
+}
+
+TEST(paxos_service, propose_interval_follows_rounds) {
+  // the interval tracks the rounds as they speed up and slow down
+  double avg = 0;
+  for (int i = 0; i < 50; ++i) {
+    avg = Paxos::update_round_latency(avg, 0.02, min_wait, propose_interval);
+  }
+  double fast = PaxosService::get_propose_interval(
+    propose_interval, min_wait, avg, true);
+  ASSERT_NEAR(4 * min_wait, fast, 1e-6);
+  for (int i = 0; i < 50; ++i) {
+    avg = Paxos::update_round_latency(avg, 0.1, min_wait, propose_interval);
+  }
+  double slow = PaxosService::get_propose_interval(
+    propose_interval, min_wait, avg, true);
+  ASSERT_NEAR(0.4, slow, 1e-6);
+  ASSERT_LT(fast, slow);
+  for (int i = 0; i < 50; ++i) {
+    avg = Paxos::update_round_latency(avg, 5, min_wait, propose_interval);
+  }
+  ASSERT_DOUBLE_EQ(propose_interval,
+		   PaxosService::get_propose_interval(
+		     propose_interval, min_wait, avg, true));
+}
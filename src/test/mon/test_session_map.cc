@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#include <set>
+#include <vector>
+
+#include "global/global_context.h"
+#include "mon/Session.h"
+#include "msg/Connection.h"
+#include "msg/Message.h"
+
+#include "gtest/gtest.h"
+
+class TestConnection : public Connection {
+public:
+  explicit TestConnection(const entity_addrvec_t &addrs)
+    : Connection(g_ceph_context, nullptr) {
+    set_peer_type(CEPH_ENTITY_TYPE_OSD);
+    set_peer_addrs(addrs);
+  }
+  bool is_connected() override { return true; }
+  int send_message(Message *m) override {
+    m->put();
+    return 0;
+  }
+  void send_keepalive() override {}
+  void mark_down() override {}
+  void mark_disposable() override {}
+  entity_addr_t get_peer_socket_addr() const override {
+    return get_peer_addrs().front();
+  }
+};
+
+class SessionMapTest : public ::testing::Test {
+protected:
+  static constexpr int num_osds = 10;
+  OSDMap osdmap;
+  MonSessionMap session_map;
+
+  static entity_addrvec_t get_addrs(int osd) {
+    entity_addr_t addr;
+    addr.set_type(entity_addr_t::TYPE_MSGR2);
+    addr.set_nonce(osd + 1);
+    return entity_addrvec_t(addr);
+  }
+
+  void SetUp() override {
+    uuid_d fsid;
+    osdmap.build_simple(g_ceph_context, 0, fsid, num_osds);
+    OSDMap::Incremental pending_inc(osdmap.get_epoch() + 1);
+    pending_inc.fsid = osdmap.get_fsid();
+    // the odd osds are up
+    for (int i = 1; i < num_osds; i += 2) {
+      pending_inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+      pending_inc.new_up_client[i] = get_addrs(i);
+      pending_inc.new_up_cluster[i] = get_addrs(i);
+      pending_inc.new_hb_back_up[i] = get_addrs(i);
+      pending_inc.new_hb_front_up[i] = get_addrs(i);
+      pending_inc.new_weight[i] = CEPH_OSD_IN;
+    }
+    osdmap.apply_incremental(pending_inc);
+
+    for (int i = 0; i < num_osds; ++i) {
+      add_session(i, get_addrs(i));
+    }
+  }
+
+  void TearDown() override {
+    while (!session_map.sessions.empty()) {
+      session_map.remove_session(session_map.sessions.front());
+    }
+  }
+
+  void add_session(int osd, const entity_addrvec_t &addrs) {
+    auto con = ceph::make_ref<TestConnection>(addrs);
+    MonSession *s = session_map.new_session(entity_name_t::OSD(osd), addrs,
+					    con.get());
+    // the session map holds the only reference
+    s->put();
+  }
+};
+
+TEST_F(SessionMapTest, random_osd_sessions_are_up_and_distinct) {
+  // an older session of an up osd, it is not picked twice
+  add_session(3, get_addrs(3));
+  // a session from an address the osd is not up at
+  add_session(5, get_addrs(7));
+  for (size_t n = 0; n <= num_osds; ++n) {
+    auto sessions = session_map.get_random_osd_sessions(osdmap, n);
+    ASSERT_EQ(std::min<size_t>(n, num_osds / 2), sessions.size());
+    std::set<int> osds;
+    for (auto s : sessions) {
+      int osd = s->name.num();
+      ASSERT_TRUE(osdmap.is_up(osd));
+      ASSERT_EQ(osdmap.get_addrs(osd), s->con->get_peer_addrs());
+      ASSERT_TRUE(osds.insert(osd).second);
+    }
+  }
+}
+
+TEST_F(SessionMapTest, random_osd_sessions_are_random) {
+  std::set<int> picked;
+  for (int i = 0; i < 1000 && picked.size() < num_osds / 2; ++i) {
+    auto sessions = session_map.get_random_osd_sessions(osdmap, 1);
+    ASSERT_EQ(1u, sessions.size());
+    picked.insert(sessions.front()->name.num());
+  }
+  ASSERT_EQ((size_t)num_osds / 2, picked.size());
+}
+
+TEST_F(SessionMapTest, random_osd_sessions_none_up) {
+  OSDMap empty;
+  uuid_d fsid;
+  empty.build_simple(g_ceph_context, 0, fsid, num_osds);
+  ASSERT_TRUE(session_map.get_random_osd_sessions(empty, 3).empty());
+}
@@ -21,6 +21,8 @@
 #include <random>
 #include <string>
 #include <set>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <gtest/gtest.h>
 
@@ -436,6 +438,51 @@ TEST_P(NetworkWorkerTest, AcceptAndCloseTest) {
   });
 }
 
+TEST_P(NetworkWorkerTest, WorkerForCpuTest) {
+  unsigned num = stack->get_num_worker();
+  if (num < 3) {
+    GTEST_SKIP() << "needs three workers";
+  }
+  // pretend the workers are pinned: two of them to cpus 0 and 1 of
+  // node 0, and one to cpu 2 of node 1
+  const std::vector<std::pair<int, int>> pinned = {{0, 0}, {1, 0}, {2, 1}};
+  for (unsigned i = 0; i < num; ++i) {
+    Worker *w = get_worker(i);
+    std::tie(w->cpu, w->numa_node) =
+      i < pinned.size() ? pinned[i] : std::make_pair(-1, -1);
+  }
+  auto pick = [this](int cpu, int numa_node) {
+    Worker *w = stack->get_worker_for_cpu(cpu, numa_node);
+    if (w) {
+      // drop the reference the caller would hand to the connection
+      --w->references;
+    }
+    return w;
+  };
+
+  // the worker on the incoming cpu, whatever the load of the others
+  get_worker(0)->references += 10;
+  ASSERT_EQ(get_worker(0), pick(0, 0));
+  ASSERT_EQ(get_worker(1), pick(1, 0));
+  ASSERT_EQ(get_worker(2), pick(2, 1));
+  // otherwise the least loaded worker on the same node
+  ASSERT_EQ(get_worker(1), pick(3, 0));
+  get_worker(0)->references -= 10;
+  get_worker(1)->references += 10;
+  ASSERT_EQ(get_worker(0), pick(3, 0));
+  get_worker(1)->references -= 10;
+  ASSERT_EQ(get_worker(2), pick(4, 1));
+  // and none if the cpu isn't on a node with pinned workers, so that
+  // the caller falls back to its own choice
+  ASSERT_EQ(nullptr, pick(5, 2));
+  ASSERT_EQ(nullptr, pick(5, -1));
+  ASSERT_EQ(nullptr, pick(-1, -1));
+
+  for (unsigned i = 0; i < num; ++i) {
+    get_worker(i)->cpu = get_worker(i)->numa_node = -1;
+  }
+}
+
 TEST_P(NetworkWorkerTest, ComplexTest) {
   entity_addr_t bind_addr;
   std::atomic_bool listen_done(false);
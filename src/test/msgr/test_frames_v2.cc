@@ -14,6 +14,8 @@
 
 #include "msg/async/frames_v2.h"
 
+#include <algorithm>
+#include <iterator>
 #include <numeric>
 #include <ostream>
 #include <string>
@@ -147,6 +149,23 @@ static bufferlist make_bufferlist(size_t len, char c) {
   return bl;
 }
 
+// same contents, spread over many buffers of assorted sizes like
+// an encoded message would be
+static bufferlist make_fragmented(const bufferlist& bl) {
+  static const unsigned piece_lens[] = {1, 7, 100, 4095, 4096, 13, 5000};
+  bufferlist fragmented;
+  unsigned off = 0;
+  for (size_t i = 0; off < bl.length(); i++) {
+    unsigned len = std::min<unsigned>(piece_lens[i % std::size(piece_lens)],
+                                      bl.length() - off);
+    bufferlist piece;
+    piece.substr_of(bl, off, len);
+    fragmented.append(buffer::copy(piece.c_str(), len));
+    off += len;
+  }
+  return fragmented;
+}
+
 bool disassemble_frame(FrameAssembler& frame_asm, bufferlist& frame_bl,
                        Tag& tag, segment_bls_t& segment_bls) {
   bufferlist preamble_bl;
@@ -232,8 +251,11 @@ protected:
                       frame_asm.get_frame_onwire_len());
   }
 
-  void test_round_trip() {
-    auto tx_frame = TestFrame::Encode(m_header, m_front, m_middle, m_data);
+  void test_round_trip(bool fragmented = false) {
+    auto tx_frame = fragmented ?
+      TestFrame::Encode(make_fragmented(m_header), make_fragmented(m_front),
+                        make_fragmented(m_middle), make_fragmented(m_data)) :
+      TestFrame::Encode(m_header, m_front, m_middle, m_data);
     auto onwire_bl = tx_frame.get_buffer(m_tx_frame_asm);
     check_frame_assembler(m_tx_frame_asm);
     EXPECT_EQ(m_tx_frame_asm.get_frame_onwire_len(), onwire_bl.length());
@@ -279,6 +301,12 @@ TEST_P(RoundTripTest, Reuse) {
   }
 }
 
+TEST_P(RoundTripTest, Fragmented) {
+  for (int i = 0; i < 3; i++) {
+    test_round_trip(true);
+  }
+}
+
 static const round_trip_instance_t round_trip_instances[] = {
   // first segment is empty
   { 0,   0,   0,   0, 1, {{32,  0,  17,   0,   0,  0},
@@ -422,6 +450,71 @@ INSTANTIATE_TEST_SUITE_P(
         ::testing::ValuesIn(round_trip_instances),
         ::testing::ValuesIn(modes)));
 
+TEST(CompressionTest, IncompressibleBackoff) {
+  CompConnectionMeta comp_meta;
+  comp_meta.con_mode = Compressor::COMP_FORCE;
+  comp_meta.con_method = Compressor::COMP_ALG_SNAPPY;
+  auto tx_comp = ceph::compression::onwire::rxtx_t::create_handler_pair(
+    g_ceph_context, comp_meta, /*min_compress_size=*/COMP_THRESHOLD);
+  auto rx_comp = ceph::compression::onwire::rxtx_t::create_handler_pair(
+    g_ceph_context, comp_meta, /*min_compress_size=*/COMP_THRESHOLD);
+  ASSERT_TRUE(tx_comp.tx);
+  ceph::crypto::onwire::rxtx_t tx_crypto;
+  ceph::crypto::onwire::rxtx_t rx_crypto;
+  FrameAssembler tx_frame_asm(&tx_crypto, true, true, &tx_comp);
+  FrameAssembler rx_frame_asm(&rx_crypto, true, true, &rx_comp);
+
+  const bufferlist compressible = make_bufferlist(8192, 'D');
+  bufferlist incompressible;
+  {
+    buffer::ptr bp(8192);
+    g_ceph_context->random()->get_bytes(bp.c_str(), bp.length());
+    incompressible.append(std::move(bp));
+  }
+
+  auto round_trip = [&](const bufferlist& data) {
+    auto tx_frame = TestFrame::Encode(bufferlist(), bufferlist(),
+                                      bufferlist(), data);
+    auto onwire_bl = tx_frame.get_buffer(tx_frame_asm);
+
+    Tag rx_tag;
+    segment_bls_t rx_segment_bls;
+    ASSERT_TRUE(disassemble_frame(rx_frame_asm, onwire_bl, rx_tag,
+                                  rx_segment_bls));
+    auto rx_frame = TestFrame::Decode(rx_segment_bls);
+    EXPECT_TRUE(data.contents_equal(rx_frame.data()));
+  };
+
+  const auto& stats = tx_comp.tx->get_stats();
+  round_trip(compressible);
+  EXPECT_EQ(1u, stats.frames_compressed);
+  EXPECT_GT(stats.bytes_in, stats.bytes_out);
+
+  // sent as is, and the next frame is not even tried
+  round_trip(incompressible);
+  EXPECT_EQ(1u, stats.frames_incompressible);
+  round_trip(compressible);
+  EXPECT_EQ(1u, stats.frames_skipped);
+  EXPECT_EQ(1u, stats.frames_compressed);
+
+  // still incompressible, back off for longer
+  round_trip(incompressible);
+  EXPECT_EQ(2u, stats.frames_incompressible);
+  round_trip(compressible);
+  round_trip(compressible);
+  EXPECT_EQ(3u, stats.frames_skipped);
+
+  // a compressible sample resets the backoff
+  round_trip(compressible);
+  EXPECT_EQ(2u, stats.frames_compressed);
+  round_trip(incompressible);
+  EXPECT_EQ(3u, stats.frames_incompressible);
+  round_trip(compressible);
+  EXPECT_EQ(4u, stats.frames_skipped);
+  round_trip(compressible);
+  EXPECT_EQ(3u, stats.frames_compressed);
+}
+
 class RoundTripPerfTest : public RoundTripTestBase {};
 
 TEST_P(RoundTripPerfTest, DISABLED_Basic) {
@@ -436,6 +529,22 @@ TEST_P(RoundTripPerfTest, DISABLED_Basic) {
   }
 }
 
+TEST_P(RoundTripPerfTest, DISABLED_Fragmented) {
+  const auto header = make_fragmented(m_header);
+  const auto front = make_fragmented(m_front);
+  const auto middle = make_fragmented(m_middle);
+  const auto data = make_fragmented(m_data);
+  for (int i = 0; i < 100000; i++) {
+    auto tx_frame = TestFrame::Encode(header, front, middle, data);
+    auto onwire_bl = tx_frame.get_buffer(m_tx_frame_asm);
+
+    Tag rx_tag;
+    segment_bls_t rx_segment_bls;
+    ASSERT_TRUE(disassemble_frame(m_rx_frame_asm, onwire_bl, rx_tag,
+                                  rx_segment_bls));
+  }
+}
+
 static const round_trip_instance_t round_trip_perf_instances[] = {
   {41, 250, 0,       0, 2, {{32, 41, 250, 17,       0,  0},
                             {32, 48, 256, 32,       0,  0},
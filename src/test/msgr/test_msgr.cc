@@ -14,11 +14,17 @@
  *
  */
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <set>
+#include <sstream>
+#include <vector>
 #include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
@@ -45,6 +51,7 @@ typedef boost::mt11213b gen_type;
 
 #include "common/dout.h"
 #include "include/ceph_assert.h"
+#include "include/scope_guard.h"
 
 #include "auth/DummyAuth.h"
 
@@ -976,6 +983,510 @@ TEST_P(MessengerTest, SimpleTest) {
   server_msgr->wait();
 }
 
+TEST_P(MessengerTest, LocalSocketTest) {
+  char dir[] = "/tmp/test_msgr_local.XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(dir));
+  g_ceph_context->_conf.set_val("ms_local_socket_dir", dir);
+  auto reset_conf = make_scope_guard([&] {
+    g_ceph_context->_conf.set_val("ms_local_socket_dir", "");
+    rmdir(dir);
+  });
+  // connected sockets bound to path; accepted unix sockets show up with
+  // the path of their listener in /proc/net/unix
+  auto count_connected = [](const string& path) {
+    std::ifstream in("/proc/net/unix");
+    string line;
+    std::getline(in, line);  // header
+    unsigned n = 0;
+    while (std::getline(in, line)) {
+      std::istringstream ss(line);
+      vector<string> fields{std::istream_iterator<string>(ss),
+			    std::istream_iterator<string>()};
+      // Num RefCount Protocol Flags Type St Inode Path, St 03 is connected
+      if (fields.size() == 8 && fields[5] == "03" && fields[7] == path) {
+	++n;
+      }
+    }
+    return n;
+  };
+
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  const string path = string(dir) + "/msgr-" +
+    server_msgr->get_myaddrs().front().ip_n_port_to_str() + ".sock";
+  ASSERT_EQ(0, access(path.c_str(), F_OK));
+
+  // goes through the unix socket
+  MPing *m = new MPing();
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  {
+    ASSERT_EQ(conn->send_message(m), 0);
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] { return cli_dispatcher.got_new; });
+    cli_dispatcher.got_new = false;
+  }
+  ASSERT_TRUE(conn->is_connected());
+  ASSERT_EQ(1u, static_cast<Session*>(conn->get_priv().get())->get_count());
+  // connect_local() falls back to tcp, make sure it did not
+  ASSERT_LE(1u, count_connected(path));
+  conn->mark_down();
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+  CHECK_AND_WAIT_TRUE(access(path.c_str(), F_OK) < 0);
+  ASSERT_GT(0, access(path.c_str(), F_OK));
+}
+
+TEST_P(MessengerTest, ZeroCopyTest) {
+  g_ceph_context->_conf.set_val("ms_tcp_zerocopy", "true");
+  auto reset_conf = make_scope_guard([] {
+    g_ceph_context->_conf.set_val("ms_tcp_zerocopy", "false");
+  });
+
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // large enough for MSG_ZEROCOPY, and many of them so that sends
+  // overlap the completions of earlier ones
+  const unsigned num = 64;
+  const unsigned len = 1 << 20;
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  // our references to the data, the only ones left once the messenger
+  // is done with it
+  std::vector<bufferptr> sent;
+  auto all_released = [&sent] {
+    return std::all_of(sent.begin(), sent.end(), [](const bufferptr& bp) {
+      return bp.raw_nref() == 1;
+    });
+  };
+  for (unsigned i = 0; i < num; ++i) {
+    MPing *m = new MPing();
+    bufferptr bp(len);
+    memset(bp.c_str(), i, len);
+    sent.push_back(bp);
+    bufferlist bl;
+    bl.append(std::move(bp));
+    m->set_data(bl);
+    ASSERT_EQ(conn->send_message(m), 0);
+  }
+  {
+    // data crc errors would fault the lossy connection and lose replies
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] {
+      auto s = static_cast<Session*>(conn->get_priv().get());
+      return s && s->get_count() == num;
+    });
+  }
+  ASSERT_TRUE(conn->is_connected());
+  // the completions of the zerocopy sends release the buffers while
+  // the connection is still up
+  CHECK_AND_WAIT_TRUE(all_released());
+  ASSERT_TRUE(all_released());
+  // and a close releases whatever is left
+  for (unsigned i = 0; i < num; ++i) {
+    MPing *m = new MPing();
+    bufferlist bl;
+    bl.append(sent[i]);
+    m->set_data(bl);
+    ASSERT_EQ(conn->send_message(m), 0);
+  }
+  conn->mark_down();
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  ASSERT_TRUE(all_released());
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+TEST_P(MessengerTest, DataOffTest) {
+  // keeps the data of the messages it gets
+  struct DataDispatcher : public FakeDispatcher {
+    std::list<bufferlist> data;
+    DataDispatcher() : FakeDispatcher(true) {}
+    void ms_fast_dispatch(Message *m) override {
+      {
+	std::lock_guard l{lock};
+	data.push_back(m->get_data());
+      }
+      FakeDispatcher::ms_fast_dispatch(m);
+    }
+  };
+  FakeDispatcher cli_dispatcher(false);
+  DataDispatcher srv_dispatcher;
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  const unsigned len = 3 * CEPH_PAGE_SIZE;
+  for (unsigned data_off : {0u, 1000u, CEPH_PAGE_SIZE + 100u}) {
+    MPing *m = new MPing();
+    bufferlist bl;
+    bl.append(std::string(len, 'a' + data_off % 26));
+    m->set_data(bl);
+    m->get_header().data_off = data_off;
+    ASSERT_EQ(conn->send_message(m), 0);
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] { return cli_dispatcher.got_new; });
+    cli_dispatcher.got_new = false;
+  }
+  {
+    std::lock_guard l{srv_dispatcher.lock};
+    ASSERT_EQ(3u, srv_dispatcher.data.size());
+    // the data is laid out the way data_off asks for in crc mode
+    for (unsigned data_off : {0u, 1000u, CEPH_PAGE_SIZE + 100u}) {
+      bufferlist& bl = srv_dispatcher.data.front();
+      ASSERT_EQ(len, bl.length());
+      ASSERT_EQ(1u, bl.get_num_buffers()) << "data_off " << data_off;
+      EXPECT_EQ(data_off & ~CEPH_PAGE_MASK,
+		(uintptr_t)bl.front().c_str() & ~CEPH_PAGE_MASK)
+	<< "data_off " << data_off;
+      EXPECT_EQ(std::string(len, 'a' + data_off % 26), bl.to_str());
+      srv_dispatcher.data.pop_front();
+    }
+  }
+  conn->mark_down();
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+// negotiates secure mode, with a fixed connection secret
+class SecureDummyAuth : public DummyAuthClientServer {
+  // the key and the two nonces of AES128-GCM
+  const std::string secret = std::string(16 + 2 * 12, 's');
+public:
+  std::atomic<unsigned> secure_connects = 0;
+
+  using DummyAuthClientServer::DummyAuthClientServer;
+  int get_auth_request(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    uint32_t *method,
+    std::vector<uint32_t> *preferred_modes,
+    bufferlist *out) override {
+    *method = CEPH_AUTH_NONE;
+    *preferred_modes = { CEPH_CON_MODE_SECURE };
+    return 0;
+  }
+  int handle_auth_done(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    uint64_t global_id,
+    uint32_t con_mode,
+    const bufferlist& bl,
+    CryptoKey *session_key,
+    std::string *connection_secret) override {
+    if (con_mode == CEPH_CON_MODE_SECURE) {
+      ++secure_connects;
+    }
+    *connection_secret = secret;
+    return 0;
+  }
+  uint32_t pick_con_mode(
+    int peer_type,
+    uint32_t auth_method,
+    const std::vector<uint32_t>& preferred_modes) override {
+    return CEPH_CON_MODE_SECURE;
+  }
+  int handle_auth_request(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    bool more,
+    uint32_t auth_method,
+    const bufferlist& bl,
+    bufferlist *reply) override {
+    auth_meta->connection_secret = secret;
+    return 1;
+  }
+};
+
+// Send messages whose small segments are read into a shared buffer by
+// the receiver, and check them once all of them have arrived, i.e. long
+// after the frames that followed them reused the receive path.
+static void check_frame_segments(Messenger *server_msgr,
+				 Messenger *client_msgr,
+				 bool secure)
+{
+  // keeps the messages it gets
+  struct KeepDispatcher : public FakeDispatcher {
+    std::vector<ceph::ref_t<Message>> msgs;
+    KeepDispatcher() : FakeDispatcher(true) {}
+    void ms_fast_dispatch(Message *m) override {
+      {
+	std::lock_guard l{lock};
+	msgs.emplace_back(m);
+      }
+      FakeDispatcher::ms_fast_dispatch(m);
+    }
+  };
+  FakeDispatcher cli_dispatcher(false);
+  KeepDispatcher srv_dispatcher;
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // {front, middle, data} lengths: several small segments, empty ones
+  // between non-empty ones, and ones too large to share a buffer
+  const std::vector<std::array<unsigned, 3>> lens = {
+    {0, 0, 0}, {1, 1, 1}, {100, 0, 100}, {0, 200, 0}, {300, 400, 0},
+    {4096, 4096, 8192}, {4097, 10, 0}, {10, 4097, 10}, {0, 0, 50},
+  };
+  auto make_bl = [](unsigned seed, unsigned len) {
+    bufferlist bl;
+    for (unsigned i = 0; i < len; ++i) {
+      bl.append(static_cast<char>('a' + (seed + i) % 26));
+    }
+    return bl;
+  };
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  for (unsigned i = 0; i < lens.size(); ++i) {
+    MPing *m = new MPing();
+    bufferlist front = make_bl(i, lens[i][0]);
+    bufferlist middle = make_bl(i + 1, lens[i][1]);
+    m->set_payload(front);
+    m->set_middle(middle);
+    m->set_data(make_bl(i + 2, lens[i][2]));
+    ASSERT_EQ(conn->send_message(m), 0);
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] { return cli_dispatcher.got_new; });
+    cli_dispatcher.got_new = false;
+  }
+  {
+    std::lock_guard l{srv_dispatcher.lock};
+    ASSERT_EQ(lens.size(), srv_dispatcher.msgs.size());
+    for (unsigned i = 0; i < lens.size(); ++i) {
+      auto& m = srv_dispatcher.msgs[i];
+      ASSERT_TRUE(m->get_payload().contents_equal(make_bl(i, lens[i][0])));
+      ASSERT_TRUE(m->get_middle().contents_equal(make_bl(i + 1, lens[i][1])));
+      ASSERT_TRUE(m->get_data().contents_equal(make_bl(i + 2, lens[i][2])));
+      if (!secure && lens[i][0] && lens[i][0] <= 4096 &&
+	  lens[i][1] && lens[i][1] <= 4096) {
+	// the front and middle came out of the same buffer
+	ASSERT_EQ(1u, m->get_payload().get_num_buffers());
+	ASSERT_EQ(1u, m->get_middle().get_num_buffers());
+	ASSERT_EQ(m->get_payload().front().raw_c_str(),
+		  m->get_middle().front().raw_c_str());
+      }
+    }
+    srv_dispatcher.msgs.clear();
+  }
+  conn->mark_down();
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+TEST_P(MessengerTest, FrameSegmentsTest) {
+  check_frame_segments(server_msgr, client_msgr, false);
+}
+
+TEST_P(MessengerTest, SecureFrameSegmentsTest) {
+  SecureDummyAuth secure_auth(g_ceph_context);
+  secure_auth.auth_registry.refresh_config();
+  server_msgr->set_auth_client(&secure_auth);
+  server_msgr->set_auth_server(&secure_auth);
+  client_msgr->set_auth_client(&secure_auth);
+  client_msgr->set_auth_server(&secure_auth);
+  check_frame_segments(server_msgr, client_msgr, true);
+  ASSERT_LT(0u, secure_auth.secure_connects.load());
+}
+
+TEST_P(MessengerTest, SendBatchTest) {
+  // keeps the sequence numbers in the data of the messages it gets
+  struct SeqDispatcher : public FakeDispatcher {
+    std::vector<uint32_t> seqs;
+    SeqDispatcher() : FakeDispatcher(true) {}
+    void ms_fast_dispatch(Message *m) override {
+      {
+	std::lock_guard l{lock};
+	uint32_t seq;
+	auto p = m->get_data().cbegin();
+	decode(seq, p);
+	seqs.push_back(seq);
+      }
+      FakeDispatcher::ms_fast_dispatch(m);
+    }
+  };
+  auto reset_conf = make_scope_guard([] {
+    g_ceph_context->_conf.rm_val("ms_send_batch_size");
+  });
+
+  FakeDispatcher cli_dispatcher(false);
+  SeqDispatcher srv_dispatcher;
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // unbatched, and batches of a few small messages each
+  const uint32_t num = 1000;
+  for (auto batch_size : {"0", "512"}) {
+    g_ceph_context->_conf.set_val("ms_send_batch_size", batch_size);
+    ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+						 server_msgr->get_myaddrs());
+    for (uint32_t i = 0; i < num; ++i) {
+      MPing *m = new MPing();
+      bufferlist bl;
+      encode(i, bl);
+      m->set_data(bl);
+      ASSERT_EQ(conn->send_message(m), 0);
+    }
+    {
+      std::unique_lock l{cli_dispatcher.lock};
+      cli_dispatcher.cond.wait(l, [&] {
+	auto s = static_cast<Session*>(conn->get_priv().get());
+	return s && s->get_count() == num;
+      });
+    }
+    {
+      std::lock_guard l{srv_dispatcher.lock};
+      ASSERT_EQ(num, srv_dispatcher.seqs.size()) << batch_size;
+      for (uint32_t i = 0; i < num; ++i) {
+	ASSERT_EQ(i, srv_dispatcher.seqs[i]) << batch_size;
+      }
+      srv_dispatcher.seqs.clear();
+    }
+    conn->mark_down();
+  }
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+TEST_P(MessengerTest, DispatchBatchTest) {
+  // holds the dispatch thread in the first two messages it dispatches
+  // until they are released
+  struct BlockingDispatcher : public FakeDispatcher {
+    unsigned dispatched = 0;
+    unsigned released = 0;
+    BlockingDispatcher() : FakeDispatcher(false) {}
+    bool ms_dispatch(Message *m) override {
+      {
+	std::unique_lock l{lock};
+	unsigned n = ++dispatched;
+	cond.notify_all();
+	if (n <= 2) {
+	  cond.wait(l, [&] { return released >= n; });
+	}
+      }
+      return FakeDispatcher::ms_dispatch(m);
+    }
+    void release() {
+      std::lock_guard l{lock};
+      ++released;
+      cond.notify_all();
+    }
+    void wait_dispatched(unsigned n) {
+      std::unique_lock l{lock};
+      cond.wait(l, [&] { return dispatched >= n; });
+    }
+  };
+  const unsigned batch_size =
+    g_ceph_context->_conf.get_val<uint64_t>("ms_dispatch_batch_size");
+  const unsigned num = 4 * batch_size;
+
+  FakeDispatcher cli_dispatcher(false);
+  BlockingDispatcher srv_dispatcher;
+  ConnectionRef srv_conn;
+  srv_dispatcher.last_accept_con_ptr = &srv_conn;
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  uuid_d uuid;
+  uuid.generate_random();
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  // the first message is dispatched on its own, the rest queue up behind
+  ASSERT_EQ(conn->send_message(new MCommand(uuid)), 0);
+  srv_dispatcher.wait_dispatched(1);
+  for (unsigned i = 1; i < num; ++i) {
+    ASSERT_EQ(conn->send_message(new MCommand(uuid)), 0);
+  }
+  CHECK_AND_WAIT_TRUE(server_msgr->get_dispatch_queue_len() == int(num - 1));
+  ASSERT_EQ(int(num - 1), server_msgr->get_dispatch_queue_len());
+  ASSERT_LT(0, server_msgr->get_dispatch_queue_max_age(ceph_clock_now()));
+
+  // now a full batch is out of the queue, being dispatched
+  srv_dispatcher.release();
+  srv_dispatcher.wait_dispatched(2);
+  ASSERT_EQ(int(num - 1 - batch_size), server_msgr->get_dispatch_queue_len());
+  ASSERT_LT(0, server_msgr->get_dispatch_queue_max_age(ceph_clock_now()));
+
+  // resetting the connection discards what is queued and what is left
+  // of the batch
+  ASSERT_TRUE(srv_conn);
+  srv_conn->mark_down();
+  ASSERT_EQ(0, server_msgr->get_dispatch_queue_len());
+  ASSERT_EQ(0, server_msgr->get_dispatch_queue_max_age(ceph_clock_now()));
+  srv_dispatcher.release();
+
+  // a message on a new connection is next
+  CHECK_AND_WAIT_TRUE(!conn->is_connected());
+  conn = client_msgr->connect_to(server_msgr->get_mytype(),
+				 server_msgr->get_myaddrs());
+  ASSERT_EQ(conn->send_message(new MCommand(uuid)), 0);
+  srv_dispatcher.wait_dispatched(3);
+  {
+    std::lock_guard l{srv_dispatcher.lock};
+    ASSERT_EQ(3u, srv_dispatcher.dispatched);
+  }
+  conn->mark_down();
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
 TEST_P(MessengerTest, SimpleMsgr2Test) {
   FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
   entity_addr_t legacy_addr;
@@ -60,3 +60,36 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+TEST(ECUtil, offset_len_to_data_shards)
+{
+  // k=4, 4096 byte chunks
+  const uint64_t chunk = 4096;
+  ECUtil::stripe_info_t s(4, 4 * chunk);
+
+  auto shards = [&](uint64_t off, uint64_t len,
+		    const vector<int> &mapping = vector<int>()) {
+    set<int> out;
+    s.offset_len_to_data_shards(off, len, mapping, &out);
+    return out;
+  };
+
+  ASSERT_EQ(set<int>{}, shards(0, 0));
+  // within one chunk
+  ASSERT_EQ(set<int>{0}, shards(0, 1));
+  ASSERT_EQ(set<int>{1}, shards(chunk + 100, 200));
+  ASSERT_EQ(set<int>{3}, shards(3 * chunk, chunk));
+  // across a chunk boundary
+  ASSERT_EQ((set<int>{1, 2}), shards(2 * chunk - 1, 2));
+  // across a stripe boundary
+  ASSERT_EQ((set<int>{0, 3}), shards(4 * chunk - 1, 2));
+  // in a later stripe
+  ASSERT_EQ(set<int>{2}, shards(2 * 4 * chunk + 2 * chunk, 10));
+  // a full stripe or more, wherever it starts
+  ASSERT_EQ((set<int>{0, 1, 2, 3}), shards(0, 4 * chunk));
+  ASSERT_EQ((set<int>{0, 1, 2, 3}), shards(chunk + 1, 4 * chunk));
+  ASSERT_EQ((set<int>{0, 1, 2, 3}), shards(100, 10 * 4 * chunk));
+  // chunks placed on other shards by the code's mapping
+  ASSERT_EQ(set<int>{5}, shards(chunk, 1, vector<int>{4, 5, 6, 7, 0, 1}));
+  ASSERT_EQ((set<int>{4, 7}),
+	    shards(4 * chunk - 1, 2, vector<int>{4, 5, 6, 7, 0, 1}));
+}
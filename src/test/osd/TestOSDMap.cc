@@ -49,6 +49,17 @@ public:
 
   OSDMapTest() {}
 
+  // the members dedup() may share between maps
+  static const void *get_pg_upmap(const OSDMap& m) {
+    return m.pg_upmap.get();
+  }
+  static const void *get_pg_upmap_items(const OSDMap& m) {
+    return m.pg_upmap_items.get();
+  }
+  static const void *get_primary_affinity(const OSDMap& m) {
+    return m.osd_primary_affinity.get();
+  }
+
   void set_up_map(int new_num_osds = 6, bool no_default_pools = false) {
     num_osds = new_num_osds;
     uuid_d fsid;
@@ -2280,6 +2291,196 @@ TEST_F(OSDMapTest, blocklisting_everything) {
   }
 }
 
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map();
+  ThreadPool tp(g_ceph_context, "IncrementalMapping::tp", "mapping_tp", 4);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  auto check = [&]() {
+    auto job = mapping.start_update(osdmap, mapper, 16);
+    job->wait();
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    for (auto& [pool, pi] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pi.get_pg_num(); ++ps) {
+	pg_t pgid(ps, pool);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+    for (int osd = 0; osd < osdmap.get_max_osd(); ++osd) {
+      for (auto& pgid : mapping.get_osd_acting_pgs(osd)) {
+	vector<int> acting;
+	osdmap.pg_to_acting_osds(pgid, acting);
+	ASSERT_NE(std::find(acting.begin(), acting.end(), osd), acting.end());
+      }
+    }
+  };
+  auto apply = [&](std::function<void(OSDMap::Incremental&)> f) {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    f(inc);
+    mapping.note_incremental(osdmap, inc);
+    osdmap.apply_incremental(inc);
+  };
+
+  check();  // full
+  pg_t pgid(0, my_rep_pool);
+  vector<int> up;
+  int up_primary;
+  osdmap.pg_to_raw_up(pgid, &up, &up_primary);
+  ASSERT_EQ(3u, up.size());
+
+  // nothing that affects the mapping
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_up_thru[up[0]] = osdmap.get_epoch();
+  });
+  check();
+
+  // down, out, back in and up again
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_state[up[0]] = CEPH_OSD_UP;
+  });
+  check();
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_weight[up[0]] = CEPH_OSD_OUT;
+  });
+  check();
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_weight[up[0]] = CEPH_OSD_IN;
+  });
+  check();
+  apply([&](OSDMap::Incremental& inc) {
+    entity_addrvec_t addrs;
+    addrs.v.push_back(entity_addr_t());
+    inc.new_up_client[up[0]] = addrs;
+    inc.new_up_cluster[up[0]] = addrs;
+    inc.new_hb_back_up[up[0]] = addrs;
+    inc.new_hb_front_up[up[0]] = addrs;
+  });
+  check();
+
+  // several incrementals before the next update
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_weight[up[1]] = CEPH_OSD_IN / 2;
+    inc.new_primary_affinity[up[2]] = 0;
+  });
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+      {up[2], up[1], up[0]});
+    inc.new_pg_upmap_items[pg_t(1, my_ec_pool)] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>({{up[0], up[1]}});
+  });
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_state[up[2]] = CEPH_OSD_UP;
+  });
+  check();
+  apply([&](OSDMap::Incremental& inc) {
+    inc.new_weight[up[1]] = CEPH_OSD_IN;
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>();
+  });
+  check();
+
+  // pool changes
+  apply([&](OSDMap::Incremental& inc) {
+    pg_pool_t *p = inc.get_new_pool(my_rep_pool,
+				    osdmap.get_pg_pool(my_rep_pool));
+    p->set_pg_num(128);
+    p->set_pgp_num(128);
+  });
+  check();
+  apply([&](OSDMap::Incremental& inc) {
+    inc.old_pools.insert(my_ec_pool);
+  });
+  check();
+  for (int osd = 0; osd < osdmap.get_max_osd(); ++osd) {
+    for (auto& pgid : mapping.get_osd_acting_pgs(osd)) {
+      ASSERT_NE(my_ec_pool, pgid.pool()) << "osd." << osd;
+    }
+  }
+
+  // a missed incremental forces a full update
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_state[up[1]] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+  }
+  check();
+  tp.stop();
+}
+
+TEST_F(OSDMapTest, Dedup) {
+  set_up_map();
+  pg_t pgid(0, my_rep_pool);
+  vector<int> up;
+  int up_primary;
+  osdmap.pg_to_raw_up(pgid, &up, &up_primary);
+  ASSERT_EQ(3u, up.size());
+  int other = -1;
+  for (int i = 0; i < osdmap.get_max_osd(); ++i) {
+    if (std::find(up.begin(), up.end(), i) == up.end()) {
+      other = i;
+      break;
+    }
+  }
+  ASSERT_NE(-1, other);
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_pg_upmap_items[pgid] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>({{up[0], other}});
+    inc.new_primary_affinity[other] = CEPH_OSD_DEFAULT_PRIMARY_AFFINITY / 2;
+    osdmap.apply_incremental(inc);
+  }
+
+  // decode the next epoch into its own copy and dedup it against this one
+  OSDMap next;
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_up_thru[up[0]] = osdmap.get_epoch();
+    OSDMap tmp;
+    tmp.deepish_copy_from(osdmap);
+    tmp.apply_incremental(inc);
+    bufferlist bl;
+    tmp.encode(bl);
+    next.decode(bl);
+  }
+  ASSERT_NE(osdmap.crush, next.crush);
+  ASSERT_NE(get_pg_upmap(osdmap), get_pg_upmap(next));
+  ASSERT_NE(get_pg_upmap_items(osdmap), get_pg_upmap_items(next));
+  ASSERT_NE(nullptr, get_primary_affinity(next));
+  ASSERT_NE(get_primary_affinity(osdmap), get_primary_affinity(next));
+  OSDMap::dedup(&osdmap, &next);
+  ASSERT_EQ(osdmap.crush, next.crush);
+  ASSERT_EQ(get_pg_upmap(osdmap), get_pg_upmap(next));
+  ASSERT_EQ(get_pg_upmap_items(osdmap), get_pg_upmap_items(next));
+  ASSERT_EQ(get_primary_affinity(osdmap), get_primary_affinity(next));
+
+  // changing the upmaps of one map must not change the other
+  {
+    OSDMap::Incremental inc(next.get_epoch() + 1);
+    inc.fsid = next.get_fsid();
+    inc.old_pg_upmap_items.insert(pgid);
+    next.apply_incremental(inc);
+  }
+  vector<int> old_up, new_up;
+  osdmap.pg_to_raw_upmap(pgid, &up, &old_up);
+  next.pg_to_raw_upmap(pgid, &up, &new_up);
+  ASSERT_NE(get_pg_upmap_items(osdmap), get_pg_upmap_items(next));
+  ASSERT_EQ(get_pg_upmap(osdmap), get_pg_upmap(next));
+  ASSERT_NE(old_up, new_up);
+  ASSERT_NE(std::find(old_up.begin(), old_up.end(), other), old_up.end());
+  ASSERT_EQ(std::find(new_up.begin(), new_up.end(), other), new_up.end());
+}
+
 INSTANTIATE_TEST_SUITE_P(
   OSDMap,
   OSDMapTest,
@@ -2234,7 +2234,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   log.add(modify);
 
   EXPECT_TRUE(log.logged_object(oid));
-  pg_log_entry_t *entry = log.objects[oid];
+  pg_log_entry_t *entry = log.objects.find(oid)->second;
   EXPECT_EQ(modify.op, entry->op);
   EXPECT_EQ(modify.version, entry->version);
   EXPECT_EQ(modify.prior_version, entry->prior_version);
@@ -2248,7 +2248,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   log.add(del);
 
   EXPECT_TRUE(log.logged_object(oid));
-  entry = log.objects[oid];
+  entry = log.objects.find(oid)->second;
   EXPECT_EQ(del.op, entry->op);
   EXPECT_EQ(del.version, entry->version);
   EXPECT_EQ(del.prior_version, entry->prior_version);
@@ -2261,7 +2261,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
 		   utime_t(20,1), -ENOENT));
 
   EXPECT_TRUE(log.logged_object(oid));
-  entry = log.objects[oid];
+  entry = log.objects.find(oid)->second;
   EXPECT_EQ(del.op, entry->op);
   EXPECT_EQ(del.version, entry->version);
   EXPECT_EQ(del.prior_version, entry->prior_version);
@@ -2674,6 +2674,87 @@ TEST_F(PGLogMergeDupsTest, Superset) {
 }
 
 
+TEST_F(PGLogMergeDupsTest, TrimRemovesKeyRanges) {
+  hobject_t hoid;
+  hoid.pool = 1;
+  hoid.oid = "log";
+  ghobject_t log_oid(hoid);
+  auto ch = store->open_collection(test_coll);
+
+  // number of omap range and point removals in the last write
+  unsigned rmkeyranges = 0, rmkeys = 0;
+  auto write_out = [&]() {
+    ObjectStore::Transaction t;
+    map<string, bufferlist> km;
+    write_log_and_missing(t, &km, test_coll, log_oid, false);
+    if (!km.empty()) {
+      t.omap_setkeys(test_coll, log_oid, km);
+    }
+    rmkeyranges = rmkeys = 0;
+    for (auto i = t.begin(); i.have_op(); ) {
+      switch (i.decode_op()->op) {
+      case ObjectStore::Transaction::OP_OMAP_RMKEYRANGE:
+	++rmkeyranges;
+	break;
+      case ObjectStore::Transaction::OP_OMAP_RMKEYS:
+	++rmkeys;
+	break;
+      }
+    }
+    ASSERT_EQ(0, store->queue_transaction(ch, std::move(t)));
+  };
+  auto count_keys = [&](const std::string& prefix, bool digits) {
+    std::set<std::string> keys;
+    EXPECT_EQ(0, store->omap_get_keys(ch, log_oid, &keys));
+    return std::count_if(keys.begin(), keys.end(), [&](const auto& k) {
+      return digits ? std::isdigit(k[0]) : k.compare(0, prefix.size(), prefix) == 0;
+    });
+  };
+
+  for (unsigned i = 1; i <= 5; ++i) {
+    hobject_t oid;
+    oid.pool = 1;
+    oid.oid = "obj" + std::to_string(i);
+    pg_log_entry_t e(pg_log_entry_t::MODIFY, oid, eversion_t(10, i),
+		     eversion_t(), i,
+		     osd_reqid_t(entity_name_t::CLIENT(777), 8, i),
+		     utime_t(), 0);
+    e.mark_unrollbackable();
+    add(e);
+  }
+  log.skip_can_rollback_to_to_head();
+  write_out();
+  EXPECT_EQ(5, count_keys("", true));
+  EXPECT_EQ(0, count_keys("dup_", false));
+
+  // the three oldest entries turn into dups
+  pg_info_t info;
+  info.last_complete = eversion_t(10, 5);
+  trim(eversion_t(10, 3), info);
+  write_out();
+  EXPECT_EQ(2u, log.log.size());
+  EXPECT_EQ(3u, log.dups.size());
+  // the trimmed entries go as a range, not one key each
+  EXPECT_LE(1u, rmkeyranges);
+  EXPECT_EQ(0u, rmkeys);
+  EXPECT_EQ(2, count_keys("", true));
+  EXPECT_EQ(3, count_keys("dup_", false));
+
+  // with only two dups tracked, trimming entry 4 ages out dups 1 and 2
+  g_ceph_context->_conf.set_val_or_die("osd_pg_log_dups_tracked", "2");
+  trim(eversion_t(10, 4), info);
+  g_ceph_context->_conf.rm_val("osd_pg_log_dups_tracked");
+  write_out();
+  EXPECT_EQ(1u, log.log.size());
+  EXPECT_EQ(2u, log.dups.size());
+  EXPECT_EQ(eversion_t(10, 3), log.dups.front().version);
+  // one range for the trimmed entry and one for the aged-out dups
+  EXPECT_LE(2u, rmkeyranges);
+  EXPECT_EQ(0u, rmkeys);
+  EXPECT_EQ(1, count_keys("", true));
+  EXPECT_EQ(2, count_keys("dup_", false));
+}
+
 struct PGLogTrimTest :
   public ::testing::Test,
   public PGLogTestBase,
@@ -2745,6 +2826,50 @@ TEST_F(PGLogTrimTest, TestPartialTrim)
 }
 
 
+TEST_F(PGLogTrimTest, TestTrimKeepsIndexKeys)
+{
+  SetUp(20);
+  PGLog::IndexedLog log;
+  log.head = mk_evt(24, 0);
+  log.skip_can_rollback_to_to_head();
+  log.head = mk_evt(9, 0);
+
+  entity_name_t client = entity_name_t::CLIENT(777);
+
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(8, 70),
+		     osd_reqid_t(client, 8, 1)));
+  log.add(mk_ple_mod(mk_obj(2), mk_evt(15, 150), mk_evt(10, 100),
+		     osd_reqid_t(client, 8, 2)));
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(19, 160), mk_evt(10, 100),
+		     osd_reqid_t(client, 8, 3)));
+  log.index();
+
+  // the slot for obj 1 must now borrow its key from the newest entry
+  EXPECT_EQ(2u, log.objects.size());
+  EXPECT_EQ(mk_evt(19, 160), log.objects.find(mk_obj(1))->second->version);
+
+  std::set<eversion_t> trimmed;
+  std::set<std::string> trimmed_dups;
+  eversion_t write_from_dups = eversion_t::max();
+
+  log.trim(cct, mk_evt(15, 150), &trimmed, &trimmed_dups, &write_from_dups);
+
+  EXPECT_EQ(1u, log.log.size());
+  EXPECT_EQ(1u, log.objects.size());
+  EXPECT_EQ(0u, log.objects.count(mk_obj(2)));
+  ASSERT_TRUE(log.logged_object(mk_obj(1)));
+  EXPECT_EQ(mk_evt(19, 160), log.objects.find(mk_obj(1))->second->version);
+  EXPECT_EQ(1u, log.caller_ops.size());
+  EXPECT_TRUE(log.logged_req(osd_reqid_t(client, 8, 3)));
+  EXPECT_FALSE(log.logged_req(osd_reqid_t(client, 8, 1)));
+  // only the entry at 150 is within the 20 dups tracked
+  EXPECT_EQ(1u, log.dups.size());
+  EXPECT_EQ(1u, log.dup_index.size());
+  EXPECT_EQ(0u, log.dup_index.count(osd_reqid_t(client, 8, 1)));
+  EXPECT_EQ(1u, log.dup_index.count(osd_reqid_t(client, 8, 2)));
+}
+
+
 TEST_F(PGLogTrimTest, TestTrimNoTrimmed) {
   SetUp(20);
   PGLog::IndexedLog log;
@@ -122,3 +122,64 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+TEST(ectransaction, parity_delta)
+{
+  hobject_t h;
+  ECUtil::stripe_info_t sinfo(4, 4 * 4096);
+  auto get_hinfo = [&](const hobject_t &i) {
+    ECUtil::HashInfoRef ref(new ECUtil::HashInfo(6));
+    ref->set_projected_total_logical_size(sinfo, 4 * 16384);
+    return ref;
+  };
+  auto write = [&](uint64_t off, uint64_t len) {
+    PGTransactionUPtr t(new PGTransaction);
+    bufferlist a;
+    a.append_zero(len);
+    t->write(h, off, a.length(), a, 0);
+    return t;
+  };
+
+  // overwrites part of chunks 1 and 2 of the second stripe
+  {
+    auto plan = ECTransaction::get_write_plan(
+      sinfo, write(16384 + 4096 + 100, 4096), get_hinfo,
+      [](const hobject_t &) -> uint64_t { return 2; },
+      &dpp);
+    ASSERT_EQ(0u, plan.to_read.size());
+    ASSERT_EQ(1u, plan.parity_deltas.size());
+    EXPECT_EQ(16384u, plan.parity_deltas[h].offset);
+    EXPECT_EQ((std::set<int>{1, 2}), plan.parity_deltas[h].chunks);
+    extent_set expected;
+    expected.insert(16384 + 4096, 8192);
+    EXPECT_EQ(expected, plan.will_write[h]);
+  }
+
+  // too many chunks for a delta, read the stripe
+  {
+    auto plan = ECTransaction::get_write_plan(
+      sinfo, write(16384 + 4096 + 100, 4096), get_hinfo,
+      [](const hobject_t &) -> uint64_t { return 1; },
+      &dpp);
+    ASSERT_EQ(0u, plan.parity_deltas.size());
+    ASSERT_EQ(1u, plan.to_read.size());
+  }
+
+  // spans two stripes
+  {
+    auto plan = ECTransaction::get_write_plan(
+      sinfo, write(2 * 16384 - 100, 200), get_hinfo,
+      [](const hobject_t &) -> uint64_t { return 2; },
+      &dpp);
+    ASSERT_EQ(0u, plan.parity_deltas.size());
+  }
+
+  // extends the object
+  {
+    auto plan = ECTransaction::get_write_plan(
+      sinfo, write(4 * 16384 - 100, 200), get_hinfo,
+      [](const hobject_t &) -> uint64_t { return 2; },
+      &dpp);
+    ASSERT_EQ(0u, plan.parity_deltas.size());
+  }
+}
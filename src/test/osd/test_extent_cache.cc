@@ -280,3 +280,110 @@ TEST(extentcache, write_write_overlap2)
 
   c.release_write_pin(pin3);
 }
+
+TEST(extentcache, cached_after_release)
+{
+  hobject_t oid;
+
+  ExtentCache c;
+  c.set_max_cached_bytes(100);
+
+  // write 1 needs no read
+  ExtentCache::write_pin pin;
+  c.open_write_pin(pin);
+  auto to_write = iset_from_vector({{0, 10}, {20, 10}});
+  ASSERT_TRUE(c.reserve_extents_for_rmw(
+		oid, pin, to_write, extent_set()).empty());
+  auto write_map = imap_from_iset(to_write);
+  c.present_rmw_update(oid, pin, write_map);
+  c.release_write_pin(pin);
+  ASSERT_EQ(20u, c.get_cached_bytes());
+
+  c.print(std::cerr);
+
+  // write 2 finds what write 1 wrote
+  ExtentCache::write_pin pin2;
+  c.open_write_pin(pin2);
+  auto to_read2 = iset_from_vector({{0, 10}, {20, 5}});
+  auto to_write2 = iset_from_vector({{0, 10}, {20, 10}});
+  ASSERT_TRUE(c.reserve_extents_for_rmw(
+		oid, pin2, to_write2, to_read2).empty());
+  ASSERT_EQ(0u, c.get_cached_bytes());
+  auto pending2 = c.get_remaining_extents_for_rmw(oid, pin2, to_read2);
+  ASSERT_EQ(pending2, imap_from_iset(to_read2));
+  c.present_rmw_update(oid, pin2, imap_from_iset(to_write2));
+  c.release_write_pin(pin2);
+  ASSERT_EQ(20u, c.get_cached_bytes());
+
+  c.drop_cached();
+  ASSERT_EQ(0u, c.get_cached_bytes());
+
+  // write 3 must read again
+  ExtentCache::write_pin pin3;
+  c.open_write_pin(pin3);
+  ASSERT_EQ(
+    to_read2,
+    c.reserve_extents_for_rmw(oid, pin3, to_write2, to_read2));
+  c.release_write_pin(pin3);
+  ASSERT_EQ(0u, c.get_cached_bytes());
+}
+
+TEST(extentcache, cached_in_mempool)
+{
+  auto osd_bytes = [] {
+    return mempool::get_pool(mempool::mempool_osd).allocated_bytes();
+  };
+  hobject_t oid;
+
+  ExtentCache c;
+  c.set_max_cached_bytes(1 << 20);
+  size_t before = osd_bytes();
+  {
+    ExtentCache::write_pin pin;
+    c.open_write_pin(pin);
+    auto to_write = iset_from_vector({{0, 4096}});
+    c.reserve_extents_for_rmw(oid, pin, to_write, extent_set());
+    c.present_rmw_update(oid, pin, imap_from_iset(to_write));
+    c.release_write_pin(pin);
+  }
+  ASSERT_EQ(4096u, c.get_cached_bytes());
+  ASSERT_LE(before + 4096, osd_bytes());
+
+  c.drop_cached();
+  ASSERT_EQ(before, osd_bytes());
+}
+
+TEST(extentcache, cached_lru)
+{
+  hobject_t oid;
+
+  ExtentCache c;
+  c.set_max_cached_bytes(20);
+
+  auto write = [&](uint64_t off, uint64_t len) {
+    ExtentCache::write_pin pin;
+    c.open_write_pin(pin);
+    auto to_write = iset_from_vector({{off, len}});
+    c.reserve_extents_for_rmw(oid, pin, to_write, extent_set());
+    c.present_rmw_update(oid, pin, imap_from_iset(to_write));
+    c.release_write_pin(pin);
+  };
+  write(0, 10);
+  write(10, 10);
+  write(20, 10);
+  ASSERT_EQ(20u, c.get_cached_bytes());
+
+  c.print(std::cerr);
+
+  // the least recently written extent was evicted
+  ExtentCache::write_pin pin;
+  c.open_write_pin(pin);
+  auto to_read = iset_from_vector({{0, 30}});
+  ASSERT_EQ(
+    iset_from_vector({{0, 10}}),
+    c.reserve_extents_for_rmw(oid, pin, to_read, to_read));
+  c.release_write_pin(pin);
+
+  c.set_max_cached_bytes(0);
+  ASSERT_EQ(0u, c.get_cached_bytes());
+}
@@ -0,0 +1,147 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+
+#include "messages/MOSDMap.h"
+#include "osd/OSD.h"
+
+using namespace std;
+
+// every epoch has an incremental map of inc_size bytes and a full map of
+// full_size bytes, but those listed as missing
+struct MapStore {
+  unsigned inc_size = 100;
+  unsigned full_size = 1000;
+  set<epoch_t> missing_inc;
+  set<epoch_t> missing_full;
+
+  bool get_inc(epoch_t e, bufferlist &bl) {
+    if (missing_inc.count(e))
+      return false;
+    bl.append(string(inc_size, 'i'));
+    return true;
+  }
+  bool get_full(epoch_t e, bufferlist &bl) {
+    if (missing_full.count(e))
+      return false;
+    bl.append(string(full_size, 'f'));
+    return true;
+  }
+  epoch_t add_maps(MOSDMap *m, epoch_t since, epoch_t to, int max,
+		   ssize_t max_bytes) {
+    return OSDService::add_maps_to_msg(
+      m, since, to, max, max_bytes,
+      [this](epoch_t e, bufferlist &bl) { return get_inc(e, bl); },
+      [this](epoch_t e, bufferlist &bl) { return get_full(e, bl); });
+  }
+};
+
+static size_t get_bytes(const MOSDMap &m)
+{
+  size_t bytes = 0;
+  for (auto &[e, bl] : m.maps)
+    bytes += bl.length();
+  for (auto &[e, bl] : m.incremental_maps)
+    bytes += bl.length();
+  return bytes;
+}
+
+TEST(MapMsg, all_incrementals) {
+  MapStore store;
+  auto m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 1 << 20));
+  ASSERT_TRUE(m->maps.empty());
+  ASSERT_EQ(10u, m->incremental_maps.size());
+  ASSERT_EQ(11u, m->incremental_maps.begin()->first);
+  ASSERT_EQ(20u, m->incremental_maps.rbegin()->first);
+}
+
+TEST(MapMsg, max_maps) {
+  MapStore store;
+  auto m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 4, 1 << 20));
+  ASSERT_EQ(4u, m->incremental_maps.size());
+  ASSERT_EQ(14u, m->incremental_maps.rbegin()->first);
+}
+
+TEST(MapMsg, max_bytes) {
+  MapStore store;
+  // stops with the map that reaches the limit
+  auto m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 250));
+  ASSERT_EQ(3u, m->incremental_maps.size());
+  ASSERT_EQ(300u, get_bytes(*m));
+
+  m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 300));
+  ASSERT_EQ(3u, m->incremental_maps.size());
+
+  // but always sends one
+  m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 1));
+  ASSERT_EQ(1u, m->incremental_maps.size());
+}
+
+TEST(MapMsg, max_bytes_counts_full_maps) {
+  MapStore store;
+  store.missing_inc = {12};
+  auto m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 1150));
+  ASSERT_EQ(1u, m->maps.size());
+  ASSERT_EQ(12u, m->maps.begin()->first);
+  ASSERT_EQ(2u, m->incremental_maps.size());
+  ASSERT_EQ(1200u, get_bytes(*m));
+}
+
+TEST(MapMsg, starts_with_oldest_full_map) {
+  MapStore store;
+  auto m = ceph::make_message<MOSDMap>();
+  m->oldest_map = 15;
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 1 << 20));
+  ASSERT_EQ(1u, m->maps.size());
+  ASSERT_EQ(15u, m->maps.begin()->first);
+  ASSERT_EQ(5u, m->incremental_maps.size());
+  ASSERT_EQ(16u, m->incremental_maps.begin()->first);
+
+  // the full map counts against both limits
+  m = ceph::make_message<MOSDMap>();
+  m->oldest_map = 15;
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 100, 1000));
+  ASSERT_EQ(1u, m->maps.size());
+  ASSERT_EQ(1u, m->incremental_maps.size());
+  m = ceph::make_message<MOSDMap>();
+  m->oldest_map = 15;
+  ASSERT_EQ(0u, store.add_maps(m.get(), 10, 20, 2, 1 << 20));
+  ASSERT_EQ(1u, m->maps.size());
+  ASSERT_EQ(1u, m->incremental_maps.size());
+}
+
+TEST(MapMsg, missing_maps) {
+  MapStore store;
+  store.missing_inc = {13};
+  store.missing_full = {13};
+  auto m = ceph::make_message<MOSDMap>();
+  ASSERT_EQ(13u, store.add_maps(m.get(), 10, 20, 100, 1 << 20));
+  // what was added before is kept
+  ASSERT_EQ(2u, m->incremental_maps.size());
+  ASSERT_TRUE(m->maps.empty());
+
+  m = ceph::make_message<MOSDMap>();
+  m->oldest_map = 15;
+  store.missing_full = {15};
+  ASSERT_EQ(15u, store.add_maps(m.get(), 10, 20, 100, 1 << 20));
+  ASSERT_TRUE(m->maps.empty());
+  ASSERT_TRUE(m->incremental_maps.empty());
+}
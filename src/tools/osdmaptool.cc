@@ -62,6 +62,7 @@ void usage()
   cout << "                           max deviation from target [default: 5]" << std::endl;
   cout << "   --upmap-pool <poolname> restrict upmap balancing to 1 or more pools" << std::endl;
   cout << "   --upmap-active          Act like an active balancer, keep applying changes until balanced" << std::endl;
+  cout << "   --upmap-time            print how long each round of upmap calculation took" << std::endl;
   cout << "   --dump <format>         displays the map in plain text when <format> is 'plain', 'json' if specified format is not supported" << std::endl;
   cout << "   --tree                  displays a tree of the map" << std::endl;
   cout << "   --test-crush [--range-first <first> --range-last <last>] map pgs to acting osds" << std::endl;
@@ -154,6 +155,7 @@ int main(int argc, const char **argv)
   int upmap_max = 10;
   int upmap_deviation = 5;
   bool upmap_active = false;
+  bool upmap_time = false;
   std::set<std::string> upmap_pools;
   std::random_device::result_type upmap_seed;
   std::random_device::result_type *upmap_p_seed = nullptr;
@@ -200,6 +202,8 @@ int main(int argc, const char **argv)
       createsimple = true;
     } else if (ceph_argparse_flag(args, i, "--upmap-active", (char*)NULL)) {
       upmap_active = true;
+    } else if (ceph_argparse_flag(args, i, "--upmap-time", (char*)NULL)) {
+      upmap_time = true;
     } else if (ceph_argparse_flag(args, i, "--health", (char*)NULL)) {
       health = true;
     } else if (ceph_argparse_flag(args, i, "--with-default-pool", (char*)NULL)) {
@@ -510,7 +514,7 @@ int main(int argc, const char **argv)
       assert(r == 0);
       cout << "prepared " << total_did << "/" << upmap_max  << " changes" << std::endl;
       float elapsed_time = (end.tv_sec - begin.tv_sec) + 1.0e-9*(end.tv_nsec - begin.tv_nsec);
-      if (upmap_active)
+      if (upmap_active || upmap_time)
         cout << "Time elapsed " << elapsed_time << " secs" << std::endl;
       if (total_did > 0) {
         print_inc_upmaps(pending_inc, upmap_fd);